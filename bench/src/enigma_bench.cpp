@@ -0,0 +1,464 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "enmach/Arena.hpp"
+#include "enmach/Bombe.hpp"
+#include "enmach/DecryptionMatrix.hpp"
+#include "enmach/HillClimb.hpp"
+#include "enmach/Keyspace.hpp"
+#include "enmach/Ngrams.hpp"
+#include "enmach/PlugboardSearch.hpp"
+#include "enmach/enmach.hpp"
+#include "perf_counters.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+
+// Longest message benchmarked, 1 GiB unless configured otherwise (needs twice as much memory)
+#ifndef ENMACH_BENCH_MAX_LENGTH
+#define ENMACH_BENCH_MAX_LENGTH (std::int64_t{1} << 30)
+#endif
+
+namespace
+{
+  struct Plugboard
+  {
+    constexpr static std::string_view value = "efmqabguinkxcjordpzthwvlys"sv;
+    constexpr auto operator()(char letter) const -> char { return this->value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  constexpr std::string_view plug_pairs = "ae bf cm dq hu jn lx pr sz vw"sv;
+
+  using M1 = enmach::EnigmaM1<Plugboard, ukw::B, I, II, III>;
+  using M3 = enmach::EnigmaM3<Plugboard, ukw::C, VI, III, VIII>;
+  using M4 = enmach::EnigmaM4<Plugboard, ukw::ThinC, BETA, V, VI, VIII>;
+  // Worst case stepping: two notches on both the middle and the right rotor, so double steps happen twice as often
+  using M3Double = enmach::EnigmaM3<Plugboard, ukw::B, VI, VII, VIII>;
+  using M4Double = enmach::EnigmaM4<Plugboard, ukw::ThinB, GAMMA, VI, VII, VIII>;
+
+  template<class Machine>
+  auto make_machine() -> Machine
+  {
+    Machine machine;
+    if constexpr (Machine::Configuration::N == 4)
+    {
+      machine.setGrundstellung('i', 'g', 'z', 'q');
+      machine.setRingstellung('a', 'a', 'e', 'l');
+    }
+    else
+    {
+      machine.setGrundstellung('h', 'l', 'k');
+      machine.setRingstellung('h', 'l', 'k');
+    }
+    return machine;
+  }
+
+  // Same keys as make_machine<M1>(), make_machine<M3>() and make_machine<M4>()
+  auto make_dynamic(Model model) -> DynamicEnigma
+  {
+    switch (model)
+    {
+      case Model::M1: return DynamicEnigma(Model::M1, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "hlk"sv, "hlk"sv, plug_pairs);
+      case Model::M3: return DynamicEnigma(Model::M3, ReflectorId::C, {RotorId::VI, RotorId::III, RotorId::VIII}, "hlk"sv, "hlk"sv, plug_pairs);
+      default: return DynamicEnigma(Model::M4, ReflectorId::ThinC, {RotorId::BETA, RotorId::V, RotorId::VI, RotorId::VIII}, "aael"sv, "igzq"sv, plug_pairs);
+    }
+  }
+
+  auto make_input(std::size_t size) -> std::string
+  {
+    constexpr std::string_view ciphertext = "twnhyazgbilshewpglbpqlwqekitiafgzhwimcwdfxpafeilqzwfnrfttqhuoadvlrlgaoqkvlwlsjhwofjjsluveynrrajaqdkqbgmfycevkpfjpkowhhqzyzeqrtqikkxixtfpoemi"sv;
+    std::string                input;
+    input.reserve(size);
+    while (input.size() < size)
+      input.append(ciphertext.substr(0, size - input.size()));
+    return input;
+  }
+
+  // Same loop as decrypt() in test/src/enigma_m4_test.cpp
+  template<class EM>
+  auto decrypt(EM &em, const std::string_view &input, std::string &output) -> void
+  {
+    output.clear();
+    for (const auto &character : input)
+    {
+      em.increment();
+      if (character == '.')
+        output += '.';
+      else
+        output += em.exec(character);
+    }
+  }
+
+  // 10 B, 1 KiB, 1 MiB, 1 GiB
+  auto lengths() -> std::vector<std::int64_t>
+  {
+    std::vector<std::int64_t> result;
+    for (std::int64_t length : {std::int64_t{10}, std::int64_t{1} << 10, std::int64_t{1} << 20, std::int64_t{1} << 30})
+      if (length <= ENMACH_BENCH_MAX_LENGTH)
+        result.push_back(length);
+    return result;
+  }
+
+  auto isas() -> std::vector<std::int64_t> { return {static_cast<std::int64_t>(simd::Isa::Scalar), static_cast<std::int64_t>(simd::Isa::SSSE3), static_cast<std::int64_t>(simd::Isa::AVX2)}; }
+
+  auto isa_name(simd::Isa isa) -> const char * { return isa == simd::Isa::AVX2 ? "avx2" : isa == simd::Isa::SSSE3 ? "ssse3" : "scalar"; }
+
+  // Opened once for the whole run, so an unavailable counter is reported a single time
+  auto perf_counters() -> bench::PerfCounters &
+  {
+    static bench::PerfCounters counters;
+    return counters;
+  }
+
+  // letters/s and time/letter (in seconds, printed as e.g. 16.1ns) next to the timings, plus bytes/s and the hardware
+  // counters per letter that could be read
+  auto set_counters(benchmark::State &state, std::int64_t letters, const bench::PerfCounters::Values &counts) -> void
+  {
+    const double total            = static_cast<double>(state.iterations()) * static_cast<double>(letters);
+    state.counters["letters/s"]   = benchmark::Counter(total, benchmark::Counter::kIsRate);
+    state.counters["time/letter"] = benchmark::Counter(total, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * letters);
+
+    const bench::PerfCounters &perf = perf_counters();
+    for (std::size_t event{}; event < bench::PerfCounters::Count; ++event)
+      if (perf.available(static_cast<bench::PerfCounters::Event>(event)))
+        state.counters[std::string(bench::PerfCounters::names[event]) + "/letter"] = counts[event] / total;
+    if (perf.available(bench::PerfCounters::Cycles) && perf.available(bench::PerfCounters::Instructions) && counts[bench::PerfCounters::Cycles] > 0.0)
+      state.counters["IPC"] = counts[bench::PerfCounters::Instructions] / counts[bench::PerfCounters::Cycles];
+  }
+} // namespace
+
+template<class Machine>
+static void BM_Exec(benchmark::State &state)
+{
+  const std::string input = make_input(static_cast<std::size_t>(state.range(0)));
+  std::string       output;
+  output.reserve(input.size());
+  Machine machine = make_machine<Machine>();
+  perf_counters().start();
+  for (auto _ : state)
+  {
+    decrypt(machine, input, output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  set_counters(state, state.range(0), perf_counters().stop());
+}
+
+BENCHMARK_TEMPLATE(BM_Exec, M1)->ArgsProduct({lengths()});
+BENCHMARK_TEMPLATE(BM_Exec, M3)->ArgsProduct({lengths()});
+BENCHMARK_TEMPLATE(BM_Exec, M4)->ArgsProduct({lengths()});
+BENCHMARK_TEMPLATE(BM_Exec, M3Double)->ArgsProduct({lengths()});
+BENCHMARK_TEMPLATE(BM_Exec, M4Double)->ArgsProduct({lengths()});
+
+template<class Machine>
+static void BM_Transform(benchmark::State &state)
+{
+  const std::string input = make_input(static_cast<std::size_t>(state.range(0)));
+  const auto        isa   = static_cast<simd::Isa>(state.range(1));
+  std::string       output(input.size(), '\0');
+  Machine           machine = make_machine<Machine>();
+  perf_counters().start();
+  for (auto _ : state)
+  {
+    machine.transform(input, output.data(), isa);
+    benchmark::DoNotOptimize(output.data());
+  }
+  set_counters(state, state.range(0), perf_counters().stop());
+  state.SetLabel(isa_name(isa));
+}
+
+BENCHMARK_TEMPLATE(BM_Transform, M1)->ArgsProduct({lengths(), isas()});
+BENCHMARK_TEMPLATE(BM_Transform, M3)->ArgsProduct({lengths(), isas()});
+BENCHMARK_TEMPLATE(BM_Transform, M4)->ArgsProduct({lengths(), isas()});
+BENCHMARK_TEMPLATE(BM_Transform, M3Double)->ArgsProduct({lengths(), isas()});
+BENCHMARK_TEMPLATE(BM_Transform, M4Double)->ArgsProduct({lengths(), isas()});
+// The rotor engine only matters on the scalar path
+BENCHMARK_TEMPLATE(BM_Transform, with_engine_t<M1, rotor_engine::Arithmetic>)->Args({1 << 20, static_cast<std::int64_t>(simd::Isa::Scalar)});
+BENCHMARK_TEMPLATE(BM_Transform, with_engine_t<M3, rotor_engine::Arithmetic>)->Args({1 << 20, static_cast<std::int64_t>(simd::Isa::Scalar)});
+BENCHMARK_TEMPLATE(BM_Transform, with_engine_t<M4, rotor_engine::Arithmetic>)->Args({1 << 20, static_cast<std::int64_t>(simd::Isa::Scalar)});
+// Overhead of the counters
+BENCHMARK_TEMPLATE(BM_Transform, with_instrumentation_t<M4, instrumentation::Counting>)->ArgsProduct({{1 << 20}, isas()});
+BENCHMARK_TEMPLATE(BM_Exec, with_instrumentation_t<M4, instrumentation::Counting>)->Args({1 << 20});
+
+template<class Machine>
+static void BM_TransformSequence(benchmark::State &state)
+{
+  const std::string  input = make_input(static_cast<std::size_t>(state.range(0)));
+  const auto         isa   = static_cast<simd::Isa>(state.range(1));
+  std::string        output(input.size(), '\0');
+  Machine            machine  = make_machine<Machine>();
+  const StepSequence sequence = machine.stepSequence();
+  perf_counters().start();
+  for (auto _ : state)
+  {
+    machine.transform(input, output.data(), sequence, isa);
+    benchmark::DoNotOptimize(output.data());
+  }
+  set_counters(state, state.range(0), perf_counters().stop());
+  state.SetLabel(isa_name(isa));
+}
+
+BENCHMARK_TEMPLATE(BM_TransformSequence, M4)->ArgsProduct({lengths(), isas()});
+BENCHMARK_TEMPLATE(BM_TransformSequence, M4Double)->ArgsProduct({lengths(), isas()});
+
+template<class Machine>
+static void BM_ParallelTransform(benchmark::State &state)
+{
+  const std::string input = make_input(static_cast<std::size_t>(state.range(0)));
+  std::string       output(input.size(), '\0');
+  Machine           machine = make_machine<Machine>();
+  perf_counters().start();
+  for (auto _ : state)
+  {
+    parallel_transform(machine, input, output.data(), static_cast<std::size_t>(state.range(1)));
+    benchmark::DoNotOptimize(output.data());
+  }
+  set_counters(state, state.range(0), perf_counters().stop());
+}
+
+BENCHMARK_TEMPLATE(BM_ParallelTransform, M4)->ArgsProduct({{std::int64_t{1} << 24, std::min(std::int64_t{1} << 30, ENMACH_BENCH_MAX_LENGTH)}, {1, 2, 4, 8, 16}})->UseRealTime();
+
+static void BM_DynamicTransform(benchmark::State &state)
+{
+  const std::string input = make_input(static_cast<std::size_t>(state.range(0)));
+  const auto        isa   = static_cast<simd::Isa>(state.range(1));
+  const auto        model = static_cast<Model>(state.range(2));
+  std::string       output(input.size(), '\0');
+  DynamicEnigma     machine = make_dynamic(model);
+  perf_counters().start();
+  for (auto _ : state)
+  {
+    machine.transform(input, output.data(), isa);
+    benchmark::DoNotOptimize(output.data());
+  }
+  set_counters(state, state.range(0), perf_counters().stop());
+  state.SetLabel(std::string(model == Model::M1 ? "M1 " : model == Model::M3 ? "M3 " : "M4 ") + isa_name(isa));
+}
+
+BENCHMARK(BM_DynamicTransform)->ArgsProduct({lengths(), isas(), {static_cast<std::int64_t>(Model::M1), static_cast<std::int64_t>(Model::M3), static_cast<std::int64_t>(Model::M4)}});
+
+// Five letter groups separated by spaces, as sent
+template<class Input>
+static void BM_TransformInput(benchmark::State &state)
+{
+  std::string input = make_input(static_cast<std::size_t>(state.range(0)));
+  for (std::size_t i = 5U; i < input.size(); i += 6U)
+    input[i] = ' ';
+  std::string output(input.size(), '\0');
+  M4          m4 = make_machine<M4>();
+  perf_counters().start();
+  for (auto _ : state)
+  {
+    m4.transform<Input>(input, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+  set_counters(state, state.range(0), perf_counters().stop());
+}
+
+BENCHMARK_TEMPLATE(BM_TransformInput, input::Passthrough)->ArgsProduct({lengths()});
+BENCHMARK_TEMPLATE(BM_TransformInput, input::SkipNonLetters)->ArgsProduct({lengths()});
+BENCHMARK_TEMPLATE(BM_TransformInput, input::Placeholder)->ArgsProduct({lengths()});
+
+namespace
+{
+  // count messages of 20 to 250 letters under the M4 day key of make_dynamic, one initial position each
+  struct Traffic
+  {
+    explicit Traffic(std::size_t count)
+    {
+      for (std::size_t message{}; message < count; ++message)
+      {
+        texts.push_back(make_input(20U + message * 7919U % 231U));
+        positions.push_back({static_cast<char>('a' + message % 26U), static_cast<char>('a' + message / 26U % 26U), static_cast<char>('a' + message * 7U % 26U), static_cast<char>('a' + message * 11U % 26U)});
+        outputs.emplace_back(texts.back().size(), '\0');
+        letters += texts.back().size();
+      }
+    }
+
+    std::vector<std::string> texts;
+    std::vector<std::string> positions;
+    std::vector<std::string> outputs;
+    std::size_t              letters{};
+  };
+} // namespace
+
+// One DynamicEnigma per message, the baseline of BM_Batch
+static void BM_MessagesDynamic(benchmark::State &state)
+{
+  Traffic traffic(static_cast<std::size_t>(state.range(0)));
+  const auto isa = static_cast<simd::Isa>(state.range(1));
+  perf_counters().start();
+  for (auto _ : state)
+    for (std::size_t message{}; message < traffic.texts.size(); ++message)
+    {
+      DynamicEnigma machine(Model::M4, ReflectorId::ThinC, {RotorId::BETA, RotorId::V, RotorId::VI, RotorId::VIII}, "aael"sv, traffic.positions[message], plug_pairs);
+      machine.transform(traffic.texts[message], traffic.outputs[message].data(), isa);
+      benchmark::DoNotOptimize(traffic.outputs[message].data());
+    }
+  set_counters(state, static_cast<std::int64_t>(traffic.letters), perf_counters().stop());
+  state.SetLabel(isa_name(isa));
+}
+
+BENCHMARK(BM_MessagesDynamic)->ArgsProduct({{1000, 10000}, isas()});
+
+static void BM_Batch(benchmark::State &state)
+{
+  Traffic                           traffic(static_cast<std::size_t>(state.range(0)));
+  const auto                        isa = static_cast<simd::Isa>(state.range(1));
+  const BatchEnigma                 batch(Model::M4, ReflectorId::ThinC, {RotorId::BETA, RotorId::V, RotorId::VI, RotorId::VIII}, "aael"sv, plug_pairs);
+  std::vector<BatchEnigma::Message> messages;
+  for (std::size_t message{}; message < traffic.texts.size(); ++message)
+    messages.push_back({traffic.texts[message], traffic.positions[message], traffic.outputs[message].data()});
+  perf_counters().start();
+  for (auto _ : state)
+  {
+    batch.transform(messages, isa);
+    benchmark::DoNotOptimize(traffic.outputs.data());
+  }
+  set_counters(state, static_cast<std::int64_t>(traffic.letters), perf_counters().stop());
+  state.SetLabel(isa_name(isa));
+}
+
+BENCHMARK(BM_Batch)->ArgsProduct({{1000, 10000}, isas()});
+
+// Crib of arg(0) letters against 16 M3 rotor orders on arg(1) threads, rotor positions per second in total and per core
+static void BM_Bombe(benchmark::State &state)
+{
+  const std::string plaintext = "wettervorhersagebiskayaxxnordwestwindstaerke";
+  const auto        length    = static_cast<std::size_t>(state.range(0));
+  const auto        threads   = static_cast<std::size_t>(state.range(1));
+  DynamicEnigma     machine(Model::M3, ReflectorId::B, {RotorId::II, RotorId::IV, RotorId::I}, "aaa"sv, "bqr"sv, plug_pairs);
+  std::string       cipher(length, '\0');
+  machine.transform(std::string_view(plaintext).substr(0, length), cipher.data());
+
+  const Bombe bombe(std::string_view(plaintext).substr(0, length), cipher);
+  auto        orders = Bombe::orders(Model::M3);
+  orders.resize(16U);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(bombe.run(Model::M3, ReflectorId::B, orders, threads));
+  const double positions     = static_cast<double>(state.iterations()) * static_cast<double>(orders.size()) * 26.0 * 26.0 * 26.0;
+  state.counters["positions"] = benchmark::Counter(positions, benchmark::Counter::kIsRate);
+  const auto  cores         = std::min<std::size_t>(threads, std::max(1U, std::thread::hardware_concurrency()));
+  state.counters["per_core"]  = benchmark::Counter(positions / static_cast<double>(cores), benchmark::Counter::kIsRate);
+  state.SetLabel("loops " + std::to_string(bombe.menu().loops()));
+}
+
+BENCHMARK(BM_Bombe)->ArgsProduct({{16, 24}, {1, 2, 4, 8}})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// 250 letters against 2 M3 rotor orders on arg(0) threads, rotor positions and right rings (26^4 per order) per second
+// in total and per core. Candidate refinement is included, the n-grams come from the message itself.
+static void BM_HillClimb(benchmark::State &state)
+{
+  const std::string plaintext = "theweatherreportforthenortherncoastpredictsstrongwindsfromthewestduringthenightandheavyraininthemorning"
+                                "allshipsintheharbourshouldremainatanchoruntilthestormhaspassedandthecaptainsmustreporttheirpositions"
+                                "tothenavalcommandeveryfourhoursuntil";
+  const auto        threads   = static_cast<std::size_t>(state.range(0));
+  DynamicEnigma     machine(Model::M3, ReflectorId::B, {RotorId::II, RotorId::IV, RotorId::I}, "amk"sv, "bqr"sv, "av bs cg dl fu hz"sv);
+  std::string       cipher(plaintext.size(), '\0');
+  machine.transform(plaintext, cipher.data());
+
+  const HillClimb attack(cipher, Ngrams(plaintext, 2U), Ngrams(plaintext, 3U));
+  auto            orders = Bombe::orders(Model::M3);
+  orders.resize(2U);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(attack.run(Model::M3, ReflectorId::B, orders, threads, 8U));
+  const double positions     = static_cast<double>(state.iterations()) * static_cast<double>(orders.size()) * 26.0 * 26.0 * 26.0 * 26.0;
+  state.counters["positions"] = benchmark::Counter(positions, benchmark::Counter::kIsRate);
+  const auto  cores         = std::min<std::size_t>(threads, std::max(1U, std::thread::hardware_concurrency()));
+  state.counters["per_core"]  = benchmark::Counter(positions / static_cast<double>(cores), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_HillClimb)->Arg(1)->Arg(2)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Plugboard of arg(0) letters with 8 pairs climbed from no plugs on bigrams and then trigrams, the rotor setting known
+static void BM_PlugboardSearch(benchmark::State &state)
+{
+  const std::string_view sentence = "allshipsintheharbourshouldremainatanchoruntilthestormhaspassed"sv;
+  const auto             length   = static_cast<std::size_t>(state.range(0));
+  std::string            plaintext;
+  while (plaintext.size() < length)
+    plaintext += sentence;
+  plaintext.resize(length);
+  const std::vector<RotorId> rotors = {RotorId::II, RotorId::IV, RotorId::I};
+  DynamicEnigma              machine(Model::M3, ReflectorId::B, rotors, "amk"sv, "bqr"sv, "av bs cg dl fu hz in km"sv);
+  std::string                cipher(length, '\0');
+  machine.transform(plaintext, cipher.data());
+
+  const CompiledKey key(Model::M3, ReflectorId::B, rotors, "amk"sv, "bqr"sv);
+  const Ngrams      bigrams(plaintext, 2U);
+  const Ngrams      trigrams(plaintext, 3U);
+  for (auto _ : state)
+  {
+    PlugboardSearch search(key, cipher);
+    search.climb(bigrams);
+    benchmark::DoNotOptimize(search.climb(trigrams));
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_PlugboardSearch)->Arg(250)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// Every start position of one rotor order deciphered once into a DecryptionMatrix of arg(0) letters, then scored by
+// the index of coincidence and by trigrams from its rows
+static void BM_DecryptionMatrix(benchmark::State &state)
+{
+  const std::string_view sentence = "allshipsintheharbourshouldremainatanchoruntilthestormhaspassed"sv;
+  const auto             length   = static_cast<std::size_t>(state.range(0));
+  std::string            plaintext;
+  while (plaintext.size() < length)
+    plaintext += sentence;
+  plaintext.resize(length);
+  const std::vector<RotorId> rotors = {RotorId::II, RotorId::IV, RotorId::I};
+  DynamicEnigma              machine(Model::M3, ReflectorId::B, rotors, "amk"sv, "bqr"sv);
+  std::string                cipher(length, '\0');
+  machine.transform(plaintext, cipher.data());
+
+  const CompiledKey key(Model::M3, ReflectorId::B, rotors, "amk"sv, "aaa"sv);
+  const Ngrams      trigrams(plaintext, 3U);
+  Arena             arena(DecryptionMatrix::bytes(length));
+  for (auto _ : state)
+  {
+    arena.reset();
+    const DecryptionMatrix matrix(arena, key, cipher);
+    double                 best{};
+    for (std::size_t position{}; position < DecryptionMatrix::positions; ++position)
+      if (const double coincidence = index_of_coincidence(matrix.row(position), length); coincidence > best)
+        best = coincidence;
+    double score = -1e300;
+    for (std::size_t position{}; position < DecryptionMatrix::positions; ++position)
+      if (const double candidate = trigrams.score(matrix.row(position), length); candidate > score)
+        score = candidate;
+    benchmark::DoNotOptimize(best);
+    benchmark::DoNotOptimize(score);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * DecryptionMatrix::positions));
+}
+
+BENCHMARK(BM_DecryptionMatrix)->Arg(100)->Arg(250)->Unit(benchmark::kMillisecond);
+
+// Keyspace reduction of every model over messages of arg(0) letters, settings per canonical setting
+static void BM_KeyspaceReduction(benchmark::State &state)
+{
+  const auto length = static_cast<std::size_t>(state.range(0));
+  double     m1{};
+  double     m3{};
+  double     m4{};
+  for (auto _ : state)
+  {
+    m1 = Keyspace::reduction(Model::M1, length);
+    m3 = Keyspace::reduction(Model::M3, length);
+    m4 = Keyspace::reduction(Model::M4, length);
+  }
+  state.counters["M1"] = m1;
+  state.counters["M3"] = m3;
+  state.counters["M4"] = m4;
+}
+
+BENCHMARK(BM_KeyspaceReduction)->Arg(20)->Arg(100)->Arg(250)->Arg(1000)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,121 @@
+#ifndef ENMACH_BENCH_PERF_COUNTERS_HPP_
+#define ENMACH_BENCH_PERF_COUNTERS_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define ENMACH_BENCH_PERF 1
+#else
+#define ENMACH_BENCH_PERF 0
+#endif
+
+namespace enmach::bench
+{
+  // Linux hardware counters of the calling thread and the threads it starts, in user space only so that
+  // perf_event_paranoid <= 2 suffices.
+  // Every counter is opened on its own: the ones the kernel, the hypervisor or the container refuse are reported as
+  // unavailable once on stderr and left out, the benchmarks keep running with the rest.
+  class PerfCounters
+  {
+  public:
+    enum Event : std::size_t
+    {
+      Cycles,
+      Instructions,
+      BranchMisses,
+      L1DMisses,
+      Count
+    };
+
+    constexpr static std::array<std::string_view, Count> names = {"cycles", "instructions", "branch-misses", "L1D-misses"};
+
+    using Values = std::array<double, Count>;
+
+    PerfCounters()
+    {
+#if ENMACH_BENCH_PERF
+      constexpr std::array<std::uint64_t, Count> configs = {
+          PERF_COUNT_HW_CPU_CYCLES,
+          PERF_COUNT_HW_INSTRUCTIONS,
+          PERF_COUNT_HW_BRANCH_MISSES,
+          PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8U) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U)};
+      for (std::size_t event{}; event < Count; ++event)
+      {
+        perf_event_attr attr{};
+        attr.size           = sizeof(attr);
+        attr.type           = event == L1DMisses ? PERF_TYPE_HW_CACHE : PERF_TYPE_HARDWARE;
+        attr.config         = configs[event];
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.inherit        = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        this->fds[event]    = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0UL));
+        if (this->fds[event] < 0)
+          std::fprintf(stderr, "perf counter %s unavailable: %s\n", names[event].data(), std::strerror(errno));
+      }
+#else
+      std::fprintf(stderr, "perf counters unavailable on this platform\n");
+#endif
+    }
+
+    PerfCounters(const PerfCounters &)                     = delete;
+    auto operator=(const PerfCounters &) -> PerfCounters & = delete;
+
+    ~PerfCounters()
+    {
+#if ENMACH_BENCH_PERF
+      for (const int fd : this->fds)
+        if (fd >= 0)
+          close(fd);
+#endif
+    }
+
+    [[nodiscard]] auto available(Event event) const noexcept -> bool { return this->fds[event] >= 0; }
+
+    auto start() noexcept -> void
+    {
+#if ENMACH_BENCH_PERF
+      for (const int fd : this->fds)
+        if (fd >= 0)
+        {
+          ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+          ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Counts since start(), scaled up when the kernel multiplexed a counter with others
+    auto stop() noexcept -> Values
+    {
+      Values values{};
+#if ENMACH_BENCH_PERF
+      for (std::size_t event{}; event < Count; ++event)
+      {
+        const int fd = this->fds[event];
+        if (fd < 0)
+          continue;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        std::array<std::uint64_t, 3> read_values{};
+        if (read(fd, read_values.data(), sizeof(read_values)) == static_cast<ssize_t>(sizeof(read_values)) && read_values[2] != 0U)
+          values[event] = static_cast<double>(read_values[0]) * static_cast<double>(read_values[1]) / static_cast<double>(read_values[2]);
+      }
+#endif
+      return values;
+    }
+
+  private:
+    std::array<int, Count> fds{-1, -1, -1, -1};
+  };
+} // namespace enmach::bench
+
+#endif // ENMACH_BENCH_PERF_COUNTERS_HPP_
@@ -0,0 +1,152 @@
+#ifndef ENMACH_CLI_BLOCKING_HPP_
+#define ENMACH_CLI_BLOCKING_HPP_
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "io.hpp"
+
+namespace enmach::cli
+{
+  // Same interface as Uring on plain pread/pwrite, run by a few worker threads. At most entries requests may be in
+  // flight, both queues are allocated once.
+  class BlockingIo
+  {
+  public:
+    BlockingIo(unsigned entries, unsigned threads) : requests_(entries), completions_(entries)
+    {
+      this->workers_.reserve(threads);
+      try
+      {
+        for (unsigned worker{}; worker < threads; ++worker)
+          this->workers_.emplace_back([this] { this->work(); });
+      }
+      catch (...)
+      {
+        this->stop();
+        throw;
+      }
+    }
+
+    BlockingIo(const BlockingIo &)                     = delete;
+    auto operator=(const BlockingIo &) -> BlockingIo & = delete;
+
+    // Finishes the requests already queued
+    ~BlockingIo() { this->stop(); }
+
+    auto read(int fd, char *data, std::size_t size, std::uint64_t offset, std::uint64_t tag) -> void { this->push({false, fd, data, size, offset, tag}); }
+
+    auto write(int fd, const char *data, std::size_t size, std::uint64_t offset, std::uint64_t tag) -> void { this->push({true, fd, const_cast<char *>(data), size, offset, tag}); }
+
+    auto wait() -> Completion
+    {
+      std::unique_lock<std::mutex> lock(this->mutex_);
+      this->completed_.wait(lock, [this] { return !this->completions_.empty(); });
+      return this->completions_.pop();
+    }
+
+  private:
+    struct Request
+    {
+      bool          write;
+      int           fd;
+      char         *data;
+      std::size_t   size;
+      std::uint64_t offset;
+      std::uint64_t tag;
+    };
+
+    // Fixed capacity FIFO
+    template<class T>
+    class Queue
+    {
+    public:
+      explicit Queue(std::size_t capacity) : items_(capacity) {}
+
+      [[nodiscard]] auto empty() const noexcept -> bool { return this->count_ == 0U; }
+
+      auto push(const T &item) noexcept -> void
+      {
+        this->items_[(this->head_ + this->count_) % this->items_.size()] = item;
+        ++this->count_;
+      }
+
+      auto pop() noexcept -> T
+      {
+        const T item = this->items_[this->head_];
+        this->head_  = (this->head_ + 1U) % this->items_.size();
+        --this->count_;
+        return item;
+      }
+
+    private:
+      std::vector<T> items_;
+      std::size_t    head_{};
+      std::size_t    count_{};
+    };
+
+    auto push(const Request &request) -> void
+    {
+      {
+        const std::lock_guard<std::mutex> lock(this->mutex_);
+        this->requests_.push(request);
+      }
+      this->queued_.notify_one();
+    }
+
+    auto work() -> void
+    {
+      for (;;)
+      {
+        Request request{};
+        {
+          std::unique_lock<std::mutex> lock(this->mutex_);
+          this->queued_.wait(lock, [this] { return this->stopping_ || !this->requests_.empty(); });
+          if (this->requests_.empty())
+            return;
+          request = this->requests_.pop();
+        }
+
+        ssize_t result{};
+        do
+          result = request.write ? pwrite(request.fd, request.data, request.size, static_cast<off_t>(request.offset)) : pread(request.fd, request.data, request.size, static_cast<off_t>(request.offset));
+        while (result < 0 && errno == EINTR);
+
+        const std::int64_t outcome = result < 0 ? -static_cast<std::int64_t>(errno) : static_cast<std::int64_t>(result);
+        {
+          const std::lock_guard<std::mutex> lock(this->mutex_);
+          this->completions_.push({request.tag, outcome});
+        }
+        this->completed_.notify_one();
+      }
+    }
+
+    auto stop() noexcept -> void
+    {
+      {
+        const std::lock_guard<std::mutex> lock(this->mutex_);
+        this->stopping_ = true;
+      }
+      this->queued_.notify_all();
+      for (auto &worker : this->workers_)
+        worker.join();
+    }
+
+    std::mutex               mutex_;
+    std::condition_variable  queued_;
+    std::condition_variable  completed_;
+    Queue<Request>           requests_;
+    Queue<Completion>        completions_;
+    bool                     stopping_{};
+    std::vector<std::thread> workers_;
+  };
+} // namespace enmach::cli
+
+#endif // ENMACH_CLI_BLOCKING_HPP_
@@ -0,0 +1,55 @@
+#ifndef ENMACH_CLI_FORMAT_HPP_
+#define ENMACH_CLI_FORMAT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace enmach::cli
+{
+  // Letters in historical five letter groups, "abcde fghij ...", ten groups per line, continued across calls
+  class GroupFormatter
+  {
+  public:
+    constexpr static std::size_t group = 5U;
+    constexpr static std::size_t line  = 10U * group;
+
+    // Largest output of format for count letters
+    [[nodiscard]] constexpr static auto capacity(std::size_t count) noexcept -> std::size_t { return count + count / group + 1U; }
+
+    auto format(const char *letters, std::size_t count, char *output) noexcept -> char *
+    {
+      while (count != 0U)
+      {
+        if (this->column_ == line)
+        {
+          *output++     = '\n';
+          this->column_ = 0U;
+        }
+        else if (this->column_ != 0U && this->column_ % group == 0U)
+          *output++ = ' ';
+        const std::size_t size = std::min(count, group - this->column_ % group);
+        std::memcpy(output, letters, size);
+        output += size;
+        letters += size;
+        count -= size;
+        this->column_ += size;
+      }
+      return output;
+    }
+
+    // Ends the last line
+    auto finish(char *output) noexcept -> char *
+    {
+      if (this->column_ != 0U)
+        *output++ = '\n';
+      this->column_ = 0U;
+      return output;
+    }
+
+  private:
+    std::size_t column_{};
+  };
+} // namespace enmach::cli
+
+#endif // ENMACH_CLI_FORMAT_HPP_
@@ -0,0 +1,195 @@
+#ifndef ENMACH_CLI_IO_HPP_
+#define ENMACH_CLI_IO_HPP_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace enmach::cli
+{
+  // Transformed per call, large enough to amortize the thread start-up of parallel_transform
+  inline constexpr std::size_t block_size = std::size_t{64} << 20U;
+  inline constexpr std::size_t alignment  = std::size_t{2} << 20U;
+
+  // Outcome of an asynchronous read or write
+  struct Completion
+  {
+    std::uint64_t tag{};
+    // bytes transferred, or -errno
+    std::int64_t result{};
+  };
+
+  [[noreturn]] inline auto throw_errno(const std::string &what) -> void { throw std::system_error(errno, std::generic_category(), what); }
+
+  class FileDescriptor
+  {
+  public:
+    FileDescriptor() = default;
+
+    explicit FileDescriptor(int fd, bool owned = true) noexcept : fd_{fd}, owned_{owned} {}
+
+    FileDescriptor(FileDescriptor &&other) noexcept : fd_{other.fd_}, owned_{other.owned_} { other.owned_ = false; }
+
+    auto operator=(FileDescriptor &&other) noexcept -> FileDescriptor &
+    {
+      std::swap(this->fd_, other.fd_);
+      std::swap(this->owned_, other.owned_);
+      return *this;
+    }
+
+    ~FileDescriptor()
+    {
+      if (this->owned_)
+        close(this->fd_);
+    }
+
+    [[nodiscard]] auto get() const noexcept -> int { return this->fd_; }
+
+  private:
+    int  fd_{-1};
+    bool owned_{};
+  };
+
+  // "-" is the standard input
+  inline auto open_input(const std::string &path) -> FileDescriptor
+  {
+    if (path == "-")
+      return FileDescriptor(STDIN_FILENO, false);
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw_errno("Cannot open " + path);
+    return FileDescriptor(fd);
+  }
+
+  // "-" is the standard output
+  inline auto open_output(const std::string &path) -> FileDescriptor
+  {
+    if (path == "-")
+      return FileDescriptor(STDOUT_FILENO, false);
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+      throw_errno("Cannot create " + path);
+    return FileDescriptor(fd);
+  }
+
+  // Throws std::invalid_argument when path is the file open as input, opening it as output would truncate it first
+  inline auto refuse_overwrite(int input, const std::string &path) -> void
+  {
+    struct stat status{};
+    struct stat existing{};
+    if (path != "-" && fstat(input, &status) == 0 && stat(path.c_str(), &existing) == 0 && existing.st_dev == status.st_dev && existing.st_ino == status.st_ino)
+      throw std::invalid_argument(path + " would overwrite its own input");
+  }
+
+  // Read-only mapping of a whole regular file, empty for pipes, terminals and other streams
+  class MappedFile
+  {
+  public:
+    explicit MappedFile(int fd)
+    {
+      struct stat status{};
+      if (fstat(fd, &status) != 0)
+        throw_errno("Cannot stat input");
+      if (!S_ISREG(status.st_mode) || status.st_size == 0)
+        return;
+      void *data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED)
+        return;
+      madvise(data, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL);
+      this->data_ = static_cast<const char *>(data);
+      this->size_ = static_cast<std::size_t>(status.st_size);
+    }
+
+    MappedFile(const MappedFile &)                     = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+    ~MappedFile()
+    {
+      if (this->data_ != nullptr)
+        munmap(const_cast<char *>(this->data_), this->size_);
+    }
+
+    [[nodiscard]] auto mapped() const noexcept -> bool { return this->data_ != nullptr; }
+    [[nodiscard]] auto data() const noexcept -> const char * { return this->data_; }
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return this->size_; }
+
+  private:
+    const char *data_{};
+    std::size_t size_{};
+  };
+
+  // Huge page aligned, so that the kernel can back it with transparent huge pages
+  class Buffer
+  {
+  public:
+    explicit Buffer(std::size_t size) : size_{(size + alignment - 1U) / alignment * alignment}
+    {
+      this->data_.reset(static_cast<char *>(std::aligned_alloc(alignment, this->size_)));
+      if (this->data_ == nullptr)
+        throw std::bad_alloc();
+      madvise(this->data_.get(), this->size_, MADV_HUGEPAGE);
+    }
+
+    [[nodiscard]] auto data() const noexcept -> char * { return this->data_.get(); }
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return this->size_; }
+
+  private:
+    struct Free
+    {
+      auto operator()(char *data) const noexcept -> void { std::free(data); }
+    };
+
+    std::size_t                 size_;
+    std::unique_ptr<char, Free> data_;
+  };
+
+  // Reads until size bytes arrived or the end of the stream, returns the number of bytes read
+  inline auto read_full(int fd, char *data, std::size_t size) -> std::size_t
+  {
+    std::size_t done{};
+    while (done < size)
+    {
+      const ssize_t count = read(fd, data + done, size - done);
+      if (count == 0)
+        break;
+      if (count < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        throw_errno("Cannot read input");
+      }
+      done += static_cast<std::size_t>(count);
+    }
+    return done;
+  }
+
+  inline auto write_all(int fd, const char *data, std::size_t size) -> void
+  {
+    while (size != 0U)
+    {
+      const ssize_t count = write(fd, data, size);
+      if (count < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        throw_errno("Cannot write output");
+      }
+      data += count;
+      size -= static_cast<std::size_t>(count);
+    }
+  }
+} // namespace enmach::cli
+
+#endif // ENMACH_CLI_IO_HPP_
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "blocking.hpp"
+#include "enmach/TableCache.hpp"
+#include "enmach/enmach.hpp"
+#include "format.hpp"
+#include "io.hpp"
+#include "options.hpp"
+#include "pipeline.hpp"
+#include "uring.hpp"
+
+using namespace enmach;
+
+namespace
+{
+  // Regular files are read through their mapping, streams block by block. Every block goes through
+  // parallel_transform, then straight to the output or through the group formatter.
+  template<class Input>
+  auto encrypt(DynamicEnigma &machine, const cli::Options &options, int input, int output) -> void
+  {
+    const cli::MappedFile      mapped(input);
+    const cli::Buffer          transformed(cli::block_size);
+    std::optional<cli::Buffer> grouped;
+    std::optional<cli::Buffer> streamed;
+    cli::GroupFormatter        formatter;
+    if (options.groups)
+      grouped.emplace(cli::GroupFormatter::capacity(cli::block_size));
+    if (!mapped.mapped())
+      streamed.emplace(cli::block_size);
+
+    const auto process = [&](std::string_view block) {
+      const char *end  = parallel_transform<Input>(machine, block, transformed.data(), options.threads);
+      const auto  size = static_cast<std::size_t>(end - transformed.data());
+      if (grouped)
+        cli::write_all(output, grouped->data(), static_cast<std::size_t>(formatter.format(transformed.data(), size, grouped->data()) - grouped->data()));
+      else
+        cli::write_all(output, transformed.data(), size);
+    };
+
+    if (mapped.mapped())
+      for (std::size_t offset{}; offset < mapped.size(); offset += cli::block_size)
+        process(std::string_view(mapped.data() + offset, std::min(cli::block_size, mapped.size() - offset)));
+    else
+      for (std::size_t size{}; (size = cli::read_full(input, streamed->data(), cli::block_size)) != 0U;)
+        process(std::string_view(streamed->data(), size));
+
+    if (grouped)
+      cli::write_all(output, grouped->data(), static_cast<std::size_t>(formatter.finish(grouped->data()) - grouped->data()));
+  }
+
+  template<class Input, class Io>
+  auto encrypt_files(Io &io, const DynamicEnigma &key, const cli::Options &options, const std::vector<cli::Job> &jobs) -> void
+  {
+    cli::Pipeline<Input, Io>(io, key, options.groups).run(jobs);
+  }
+
+  // Batch mode, each input through the asynchronous pipeline from the same key
+  template<class Input>
+  auto encrypt_files(const DynamicEnigma &key, const cli::Options &options) -> void
+  {
+    std::vector<cli::Job> jobs;
+    std::set<std::string> names;
+    for (const std::string &input : options.inputs)
+    {
+      const std::string name = input.substr(input.find_last_of('/') + 1U);
+      if (name.empty() || name == "-" || !names.insert(name).second)
+        throw std::invalid_argument("Cannot name the output of " + input);
+      jobs.push_back({input, options.output_dir + '/' + name});
+    }
+
+    constexpr unsigned entries = cli::Pipeline<Input, cli::Uring>::slots;
+    std::optional<cli::Uring> uring;
+    if (options.io != cli::IoBackend::Threads)
+    {
+      try
+      {
+        uring.emplace(entries);
+      }
+      catch (const std::system_error &)
+      {
+        if (options.io == cli::IoBackend::Uring)
+          throw;
+      }
+    }
+    if (uring)
+      return encrypt_files<Input>(*uring, key, options, jobs);
+    cli::BlockingIo blocking(entries, 4U);
+    encrypt_files<Input>(blocking, key, options, jobs);
+  }
+
+  template<class Input>
+  auto run(DynamicEnigma &machine, const cli::Options &options) -> void
+  {
+    if (!options.output_dir.empty())
+      return encrypt_files<Input>(machine, options);
+    const cli::FileDescriptor input = cli::open_input(options.inputs.front());
+    cli::refuse_overwrite(input.get(), options.output);
+    const cli::FileDescriptor output = cli::open_output(options.output);
+    encrypt<Input>(machine, options, input.get(), output.get());
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  cli::Options options;
+  try
+  {
+    options = cli::parse(argc, argv);
+  }
+  catch (const std::exception &error)
+  {
+    std::fprintf(stderr, "enmach: %s\nTry 'enmach --help' for more information.\n", error.what());
+    return 2;
+  }
+  if (options.help)
+  {
+    std::fwrite(cli::usage.data(), 1U, cli::usage.size(), stdout);
+    return 0;
+  }
+
+  try
+  {
+    auto key = options.tables.empty() ? std::make_shared<const CompiledKey>(options.model, options.reflector, options.rotors, options.rings, options.positions, options.plugs)
+                                      : std::make_shared<const CompiledKey>(TableCache::openOrGenerate(options.tables, options.model)->compile(options.model, options.reflector, options.rotors, options.rings, options.positions, options.plugs));
+    DynamicEnigma machine(std::move(key));
+    switch (options.non_letters)
+    {
+      case cli::NonLetters::Strict: run<input::Strict>(machine, options); break;
+      case cli::NonLetters::Passthrough: run<input::Passthrough>(machine, options); break;
+      case cli::NonLetters::Strip: run<input::SkipNonLetters>(machine, options); break;
+    }
+  }
+  catch (const std::exception &error)
+  {
+    std::fprintf(stderr, "enmach: %s\n", error.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,203 @@
+#ifndef ENMACH_CLI_OPTIONS_HPP_
+#define ENMACH_CLI_OPTIONS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "enmach/DynamicEnigma.hpp"
+
+namespace enmach::cli
+{
+  enum class NonLetters
+  {
+    Strict,
+    Passthrough,
+    Strip
+  };
+
+  enum class IoBackend
+  {
+    Auto,
+    Uring,
+    Threads
+  };
+
+  struct Options
+  {
+    Model                    model{Model::M3};
+    ReflectorId              reflector{ReflectorId::B};
+    std::vector<RotorId>     rotors;
+    std::string              rings;
+    std::string              positions;
+    std::string              plugs;
+    NonLetters               non_letters{NonLetters::Strict};
+    bool                     groups{};
+    bool                     help{};
+    std::size_t              threads{std::max(1U, std::thread::hardware_concurrency())};
+    std::vector<std::string> inputs{"-"};
+    std::string              output{"-"};
+    // batch mode when not empty, every input is written to output_dir under its own file name
+    std::string              output_dir;
+    IoBackend                io{IoBackend::Auto};
+    // table cache file, see TableCache
+    std::string              tables;
+  };
+
+  inline constexpr std::string_view usage = R"(Usage: enmach --model M1|M3|M4 --reflector UKW --rotors R1,R2,R3[,R4] [options] [FILE]
+       enmach --model M1|M3|M4 --reflector UKW --rotors R1,R2,R3[,R4] [options] -d DIR FILE...
+Encrypts (or decrypts) FILE, or the standard input when FILE is missing or -, to the standard output.
+With --output-dir every FILE is encrypted from the same key settings into DIR under its own name.
+
+  -m, --model MODEL        M1, M3 or M4
+  -u, --reflector UKW      A, B, C, ThinB or ThinC
+  -r, --rotors LIST        comma separated rotors, left to right (I-VIII, BETA, GAMMA)
+  -g, --rings LETTERS      Ringstellung, left to right (default all A)
+  -s, --positions LETTERS  Grundstellung, left to right (default all A)
+  -p, --plugs PAIRS        plugboard pairs such as "AV BS CG"
+      --passthrough        copy non-letters unchanged, they do not step the rotors
+      --strip              leave non-letters out of the output
+      --groups             write letters in groups of five, ten groups per line (implies --strip)
+  -t, --threads N          worker threads for a single FILE (default: all cores)
+  -o, --output FILE        write to FILE instead of the standard output
+  -d, --output-dir DIR     batch mode, write each regular FILE to DIR through asynchronous I/O
+      --io BACKEND         batch I/O: auto (default), uring or threads (pread/pwrite workers)
+      --tables FILE        map precomputed rotor tables from FILE, generating it on first use
+  -h, --help               show this message
+
+Without --passthrough or --strip the first non-letter stops the tool with an error.
+)";
+
+  namespace detail
+  {
+    inline auto split_rotors(std::string_view list) -> std::vector<RotorId>
+    {
+      std::vector<RotorId> rotors;
+      while (!list.empty())
+      {
+        const std::size_t comma = list.find(',');
+        rotors.push_back(rotor_from_name(list.substr(0, comma)));
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1U);
+      }
+      return rotors;
+    }
+
+    inline auto parse_threads(std::string_view value) -> std::size_t
+    {
+      std::size_t threads{};
+      for (const char digit : value)
+      {
+        if (digit < '0' || digit > '9' || threads > 4096U)
+          throw std::invalid_argument("Invalid thread count: " + std::string(value));
+        threads = threads * 10U + static_cast<std::size_t>(digit - '0');
+      }
+      if (threads == 0U)
+        throw std::invalid_argument("Invalid thread count: " + std::string(value));
+      return threads;
+    }
+
+    inline auto parse_io(std::string_view value) -> IoBackend
+    {
+      if (value == "auto")
+        return IoBackend::Auto;
+      if (value == "uring")
+        return IoBackend::Uring;
+      if (value == "threads")
+        return IoBackend::Threads;
+      throw std::invalid_argument("Invalid I/O backend: " + std::string(value));
+    }
+  } // namespace detail
+
+  // Throws std::invalid_argument on unknown or incomplete arguments
+  inline auto parse(int argc, const char *const *argv) -> Options
+  {
+    Options                  options;
+    bool                     has_model{};
+    bool                     has_reflector{};
+    std::vector<std::string> inputs;
+    const auto               value = [argc, argv](int &index, std::string_view name) -> std::string_view {
+      if (++index == argc)
+        throw std::invalid_argument("Missing value for " + std::string(name));
+      return argv[index];
+    };
+
+    for (int index = 1; index < argc; ++index)
+    {
+      const std::string_view argument = argv[index];
+      if (argument == "-m" || argument == "--model")
+      {
+        options.model = model_from_name(value(index, argument));
+        has_model     = true;
+      }
+      else if (argument == "-u" || argument == "--reflector")
+      {
+        options.reflector = reflector_from_name(value(index, argument));
+        has_reflector     = true;
+      }
+      else if (argument == "-r" || argument == "--rotors")
+        options.rotors = detail::split_rotors(value(index, argument));
+      else if (argument == "-g" || argument == "--rings")
+        options.rings = value(index, argument);
+      else if (argument == "-s" || argument == "--positions")
+        options.positions = value(index, argument);
+      else if (argument == "-p" || argument == "--plugs")
+        options.plugs = value(index, argument);
+      else if (argument == "--passthrough")
+        options.non_letters = NonLetters::Passthrough;
+      else if (argument == "--strip")
+        options.non_letters = NonLetters::Strip;
+      else if (argument == "--groups")
+        options.groups = true;
+      else if (argument == "-t" || argument == "--threads")
+        options.threads = detail::parse_threads(value(index, argument));
+      else if (argument == "-o" || argument == "--output")
+        options.output = value(index, argument);
+      else if (argument == "-d" || argument == "--output-dir")
+        options.output_dir = value(index, argument);
+      else if (argument == "--io")
+        options.io = detail::parse_io(value(index, argument));
+      else if (argument == "--tables")
+        options.tables = value(index, argument);
+      else if (argument == "-h" || argument == "--help")
+        options.help = true;
+      else if (argument.size() > 1U && argument.front() == '-')
+        throw std::invalid_argument("Unknown option " + std::string(argument));
+      else
+        inputs.emplace_back(argument);
+    }
+    if (options.help)
+      return options;
+
+    if (!has_model || !has_reflector || options.rotors.empty())
+      throw std::invalid_argument("--model, --reflector and --rotors are required");
+    if (options.groups)
+    {
+      if (options.non_letters == NonLetters::Passthrough)
+        throw std::invalid_argument("--groups cannot be combined with --passthrough");
+      options.non_letters = NonLetters::Strip;
+    }
+    if (!options.output_dir.empty())
+    {
+      if (options.output != "-")
+        throw std::invalid_argument("--output cannot be combined with --output-dir");
+      if (inputs.empty())
+        throw std::invalid_argument("--output-dir needs at least one input file");
+    }
+    else if (inputs.size() > 1U)
+      throw std::invalid_argument("Several input files need --output-dir");
+    if (!inputs.empty())
+      options.inputs = std::move(inputs);
+    if (options.rings.empty())
+      options.rings.assign(options.rotors.size(), 'a');
+    if (options.positions.empty())
+      options.positions.assign(options.rotors.size(), 'a');
+    return options;
+  }
+} // namespace enmach::cli
+
+#endif // ENMACH_CLI_OPTIONS_HPP_
@@ -0,0 +1,279 @@
+#ifndef ENMACH_CLI_PIPELINE_HPP_
+#define ENMACH_CLI_PIPELINE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "enmach/DynamicEnigma.hpp"
+#include "format.hpp"
+#include "io.hpp"
+
+namespace enmach::cli
+{
+  struct Job
+  {
+    std::string input;
+    std::string output;
+  };
+
+  // Encrypts every job with a fresh copy of the key through an asynchronous Io (Uring or BlockingIo). Up to open_files
+  // files are read block by block, reads_per_file blocks ahead each, into a fixed ring of slots. Blocks are transformed
+  // in order per file as soon as they arrive, on the thread waiting for completions, and written from the same slot
+  // while later reads are still in flight. A block is too small to amortize starting the threads of
+  // parallel_transform, the transform overlaps with the I/O instead. Nothing is allocated per block.
+  template<class Input, class Io>
+  class Pipeline
+  {
+  public:
+    constexpr static std::size_t block          = std::size_t{1} << 20U;
+    constexpr static unsigned    slots          = 32U;
+    constexpr static unsigned    open_files     = 8U;
+    constexpr static unsigned    reads_per_file = 4U;
+
+    Pipeline(Io &io, const DynamicEnigma &key, bool groups)
+        : io_{io}, key_{key}, groups_{groups}, output_capacity_{groups ? GroupFormatter::capacity(block) : block},
+          memory_{slots * (block + this->output_capacity_) + (groups ? block : 0U)}
+    {
+      for (unsigned index{}; index < slots; ++index)
+      {
+        this->slots_[index].input  = this->memory_.data() + index * (block + this->output_capacity_);
+        this->slots_[index].output = this->slots_[index].input + block;
+      }
+      this->scratch_ = this->memory_.data() + slots * (block + this->output_capacity_);
+    }
+
+    // Returns once every output is complete and closed, throws on the first failing file after draining the requests
+    // still in flight
+    auto run(const std::vector<Job> &jobs) -> void
+    {
+      std::size_t next_job{};
+      try
+      {
+        for (;;)
+        {
+          for (File &file : this->files_)
+            if (!file.active && next_job < jobs.size())
+              this->open(file, jobs[next_job++]);
+          for (File &file : this->files_)
+            if (file.active)
+              this->issue_reads(file);
+          if (this->in_flight_ == 0U)
+          {
+            if (next_job == jobs.size())
+              return;
+            continue;
+          }
+          const Completion completion = this->io_.wait();
+          --this->in_flight_;
+          this->complete(completion);
+        }
+      }
+      catch (...)
+      {
+        for (; this->in_flight_ != 0U; --this->in_flight_)
+          this->io_.wait();
+        throw;
+      }
+    }
+
+  private:
+    enum class Stage
+    {
+      Free,
+      Reading,
+      Ready,
+      Writing
+    };
+
+    struct File;
+
+    struct Slot
+    {
+      char         *input{};
+      char         *output{};
+      File         *file{};
+      Stage         stage{Stage::Free};
+      std::uint64_t offset{};
+      std::size_t   size{};
+      std::size_t   done{};
+    };
+
+    struct File
+    {
+      bool                          active{};
+      const Job                    *job{};
+      std::optional<FileDescriptor> input;
+      std::optional<FileDescriptor> output;
+      std::optional<DynamicEnigma>  machine;
+      GroupFormatter                formatter;
+      std::uint64_t                 size{};
+      std::uint64_t                 next_read{};
+      std::uint64_t                 next_transform{};
+      std::uint64_t                 written{};
+      unsigned                      reads{};
+      unsigned                      held{};
+    };
+
+    auto open(File &file, const Job &job) -> void
+    {
+      file.input.emplace(open_input(job.input));
+      struct stat status{};
+      if (fstat(file.input->get(), &status) != 0)
+        throw_errno("Cannot stat " + job.input);
+      if (!S_ISREG(status.st_mode))
+        throw std::invalid_argument(job.input + " is not a regular file");
+      refuse_overwrite(file.input->get(), job.output);
+      file.output.emplace(open_output(job.output));
+      file.machine.emplace(this->key_);
+      file.formatter      = GroupFormatter{};
+      file.job            = &job;
+      file.size           = static_cast<std::uint64_t>(status.st_size);
+      file.next_read      = 0U;
+      file.next_transform = 0U;
+      file.written        = 0U;
+      file.active         = true;
+      this->finish_if_done(file);
+    }
+
+    auto issue_reads(File &file) -> void
+    {
+      for (Slot &slot : this->slots_)
+      {
+        if (file.reads == reads_per_file || file.next_read == file.size)
+          return;
+        if (slot.stage != Stage::Free)
+          continue;
+        slot.file   = &file;
+        slot.stage  = Stage::Reading;
+        slot.offset = file.next_read;
+        slot.size   = static_cast<std::size_t>(std::min<std::uint64_t>(block, file.size - file.next_read));
+        slot.done   = 0U;
+        file.next_read += slot.size;
+        ++file.reads;
+        ++file.held;
+        this->read(slot);
+      }
+    }
+
+    auto complete(const Completion &completion) -> void
+    {
+      Slot &slot = this->slots_[completion.tag];
+      File &file = *slot.file;
+      if (completion.result < 0)
+        throw std::system_error(static_cast<int>(-completion.result), std::generic_category(), (slot.stage == Stage::Reading ? "Cannot read " + file.job->input : "Cannot write " + file.job->output));
+
+      slot.done += static_cast<std::size_t>(completion.result);
+      if (slot.stage == Stage::Reading)
+      {
+        if (completion.result == 0)
+          throw std::runtime_error(file.job->input + " shrank while being read");
+        if (slot.done < slot.size)
+          return this->read(slot);
+        slot.stage = Stage::Ready;
+        --file.reads;
+        this->transform_ready(file);
+      }
+      else
+      {
+        if (slot.done < slot.size)
+          return this->write(slot);
+        this->release(slot);
+      }
+      this->finish_if_done(file);
+    }
+
+    // Transforms the blocks of file that arrived in order, from next_transform on, and queues their writes
+    auto transform_ready(File &file) -> void
+    {
+      for (bool found = true; found;)
+      {
+        found = false;
+        for (Slot &slot : this->slots_)
+        {
+          if (slot.stage != Stage::Ready || slot.file != &file || slot.offset != file.next_transform)
+            continue;
+          found                 = true;
+          const std::size_t out = this->transform(file, slot);
+          file.next_transform += slot.size;
+          if (out == 0U)
+          {
+            this->release(slot);
+            continue;
+          }
+          slot.stage  = Stage::Writing;
+          slot.offset = file.written;
+          slot.size   = out;
+          slot.done   = 0U;
+          file.written += out;
+          this->write(slot);
+        }
+      }
+    }
+
+    auto transform(File &file, const Slot &slot) -> std::size_t
+    {
+      const std::string_view text(slot.input, slot.size);
+      if (!this->groups_)
+        return static_cast<std::size_t>(file.machine->template transform<Input>(text, slot.output) - slot.output);
+      const char *end = file.machine->template transform<Input>(text, this->scratch_);
+      return static_cast<std::size_t>(file.formatter.format(this->scratch_, static_cast<std::size_t>(end - this->scratch_), slot.output) - slot.output);
+    }
+
+    auto finish_if_done(File &file) -> void
+    {
+      if (file.next_transform != file.size || file.held != 0U)
+        return;
+      std::array<char, 1> tail{};
+      const auto          size = static_cast<std::size_t>(file.formatter.finish(tail.data()) - tail.data());
+      if (size != 0U && pwrite(file.output->get(), tail.data(), size, static_cast<off_t>(file.written)) != static_cast<ssize_t>(size))
+        throw_errno("Cannot write " + file.job->output);
+      file.input.reset();
+      file.output.reset();
+      file.active = false;
+    }
+
+    auto read(Slot &slot) -> void
+    {
+      this->io_.read(slot.file->input->get(), slot.input + slot.done, slot.size - slot.done, slot.offset + slot.done, this->tag(slot));
+      ++this->in_flight_;
+    }
+
+    auto write(Slot &slot) -> void
+    {
+      this->io_.write(slot.file->output->get(), slot.output + slot.done, slot.size - slot.done, slot.offset + slot.done, this->tag(slot));
+      ++this->in_flight_;
+    }
+
+    auto release(Slot &slot) noexcept -> void
+    {
+      --slot.file->held;
+      slot.stage = Stage::Free;
+      slot.file  = nullptr;
+    }
+
+    auto tag(const Slot &slot) const noexcept -> std::uint64_t { return static_cast<std::uint64_t>(&slot - this->slots_.data()); }
+
+    Io                          &io_;
+    const DynamicEnigma         &key_;
+    bool                         groups_;
+    std::size_t                  output_capacity_;
+    Buffer                       memory_;
+    char                        *scratch_{};
+    std::array<Slot, slots>      slots_{};
+    std::array<File, open_files> files_{};
+    unsigned                     in_flight_{};
+  };
+} // namespace enmach::cli
+
+#endif // ENMACH_CLI_PIPELINE_HPP_
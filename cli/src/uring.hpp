@@ -0,0 +1,182 @@
+#ifndef ENMACH_CLI_URING_HPP_
+#define ENMACH_CLI_URING_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "io.hpp"
+
+namespace enmach::cli
+{
+  // Minimal io_uring on the raw system calls (no liburing): reads and writes at file offsets, submitted in batches when
+  // the caller waits for a completion. Throws std::system_error when the kernel does not provide io_uring or its read
+  // and write requests. The owner waits for every request in flight before releasing their buffers.
+  class Uring
+  {
+  public:
+    explicit Uring(unsigned entries)
+    {
+      io_uring_params params{};
+      this->fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+      if (this->fd_ < 0)
+        throw_errno("io_uring_setup");
+
+      try
+      {
+        this->entries_ = params.sq_entries;
+        this->sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        this->cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0U)
+          this->sq_size_ = this->cq_size_ = std::max(this->sq_size_, this->cq_size_);
+        this->sq_ring_ = this->map(this->sq_size_, IORING_OFF_SQ_RING);
+        this->cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0U ? this->sq_ring_ : this->map(this->cq_size_, IORING_OFF_CQ_RING);
+        this->sqes_    = static_cast<io_uring_sqe *>(this->map(params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+
+        this->sq_head_  = this->at<unsigned>(this->sq_ring_, params.sq_off.head);
+        this->sq_tail_  = this->at<unsigned>(this->sq_ring_, params.sq_off.tail);
+        this->sq_mask_  = *this->at<unsigned>(this->sq_ring_, params.sq_off.ring_mask);
+        this->sq_array_ = this->at<unsigned>(this->sq_ring_, params.sq_off.array);
+        this->cq_head_  = this->at<unsigned>(this->cq_ring_, params.cq_off.head);
+        this->cq_tail_  = this->at<unsigned>(this->cq_ring_, params.cq_off.tail);
+        this->cq_mask_  = *this->at<unsigned>(this->cq_ring_, params.cq_off.ring_mask);
+        this->cqes_     = this->at<io_uring_cqe>(this->cq_ring_, params.cq_off.cqes);
+        this->probe();
+      }
+      catch (...)
+      {
+        this->release();
+        throw;
+      }
+    }
+
+    Uring(const Uring &)                     = delete;
+    auto operator=(const Uring &) -> Uring & = delete;
+
+    ~Uring() { this->release(); }
+
+    auto read(int fd, char *data, std::size_t size, std::uint64_t offset, std::uint64_t tag) -> void { this->push(IORING_OP_READ, fd, data, size, offset, tag); }
+
+    auto write(int fd, const char *data, std::size_t size, std::uint64_t offset, std::uint64_t tag) -> void { this->push(IORING_OP_WRITE, fd, const_cast<char *>(data), size, offset, tag); }
+
+    // Submits what was queued and blocks until a request completes
+    auto wait() -> Completion
+    {
+      for (;;)
+      {
+        const unsigned head = *this->cq_head_;
+        if (head != __atomic_load_n(this->cq_tail_, __ATOMIC_ACQUIRE))
+        {
+          const io_uring_cqe &cqe = this->cqes_[head & this->cq_mask_];
+          const Completion    completion{cqe.user_data, cqe.res};
+          __atomic_store_n(this->cq_head_, head + 1U, __ATOMIC_RELEASE);
+          return completion;
+        }
+        this->enter(1U);
+      }
+    }
+
+  private:
+    // IORING_OP_READ and IORING_OP_WRITE came with Linux 5.6, as did IORING_REGISTER_PROBE. Older kernels set up the
+    // ring and then fail every request with EINVAL.
+    auto probe() const -> void
+    {
+      constexpr unsigned ops = 256U;
+      alignas(io_uring_probe) std::array<unsigned char, sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op)> buffer{};
+      auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+      if (syscall(__NR_io_uring_register, this->fd_, IORING_REGISTER_PROBE, probe, ops) < 0)
+        throw_errno("io_uring probe");
+      for (const unsigned opcode : {unsigned{IORING_OP_READ}, unsigned{IORING_OP_WRITE}})
+        if (opcode >= probe->ops_len || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0U)
+          throw std::system_error(std::make_error_code(std::errc::function_not_supported), "io_uring read and write");
+    }
+
+    auto release() noexcept -> void
+    {
+      if (this->sqes_ != nullptr)
+        munmap(this->sqes_, this->entries_ * sizeof(io_uring_sqe));
+      if (this->cq_ring_ != nullptr && this->cq_ring_ != this->sq_ring_)
+        munmap(this->cq_ring_, this->cq_size_);
+      if (this->sq_ring_ != nullptr)
+        munmap(this->sq_ring_, this->sq_size_);
+      if (this->fd_ >= 0)
+        close(this->fd_);
+    }
+
+    auto map(std::size_t size, std::uint64_t offset) -> void *
+    {
+      void *ring = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd_, static_cast<off_t>(offset));
+      if (ring == MAP_FAILED)
+        throw_errno("io_uring mmap");
+      return ring;
+    }
+
+    template<class T>
+    static auto at(void *ring, std::uint32_t offset) noexcept -> T *
+    {
+      return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+    }
+
+    auto push(std::uint8_t opcode, int fd, char *data, std::size_t size, std::uint64_t offset, std::uint64_t tag) -> void
+    {
+      const unsigned tail = *this->sq_tail_;
+      if (tail - __atomic_load_n(this->sq_head_, __ATOMIC_ACQUIRE) == this->entries_)
+        this->enter(0U);
+      const unsigned index = tail & this->sq_mask_;
+      io_uring_sqe  &sqe   = this->sqes_[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode    = opcode;
+      sqe.fd        = fd;
+      sqe.addr      = reinterpret_cast<std::uint64_t>(data);
+      sqe.len       = static_cast<std::uint32_t>(size);
+      sqe.off       = offset;
+      sqe.user_data = tag;
+      this->sq_array_[index] = index;
+      __atomic_store_n(this->sq_tail_, tail + 1U, __ATOMIC_RELEASE);
+      ++this->queued_;
+    }
+
+    auto enter(unsigned wait_for) -> void
+    {
+      for (;;)
+      {
+        const long submitted = syscall(__NR_io_uring_enter, this->fd_, this->queued_, wait_for, wait_for != 0U ? IORING_ENTER_GETEVENTS : 0U, nullptr, 0);
+        if (submitted >= 0)
+        {
+          this->queued_ -= static_cast<unsigned>(submitted);
+          return;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+          throw_errno("io_uring_enter");
+      }
+    }
+
+    int           fd_{-1};
+    unsigned      entries_{};
+    unsigned      queued_{};
+    std::size_t   sq_size_{};
+    std::size_t   cq_size_{};
+    void         *sq_ring_{};
+    void         *cq_ring_{};
+    io_uring_sqe *sqes_{};
+    unsigned     *sq_head_{};
+    unsigned     *sq_tail_{};
+    unsigned      sq_mask_{};
+    unsigned     *sq_array_{};
+    unsigned     *cq_head_{};
+    unsigned     *cq_tail_{};
+    unsigned      cq_mask_{};
+    io_uring_cqe *cqes_{};
+  };
+} // namespace enmach::cli
+
+#endif // ENMACH_CLI_URING_HPP_
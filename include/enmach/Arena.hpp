@@ -0,0 +1,75 @@
+#ifndef ENMACH_ARENA_HPP_
+#define ENMACH_ARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include <sys/mman.h>
+
+namespace enmach
+{
+  // Fixed-size bump allocator for large scratch tables. Memory is taken from the system once, handed out in cache line
+  // aligned pieces and given back all at once by reset() or the destructor; objects placed in it are never destroyed,
+  // so only trivially destructible types are allowed.
+  class Arena
+  {
+  public:
+    static constexpr std::size_t alignment = 64U;
+
+    // Huge page aligned, so that the kernel can back it with transparent huge pages. Throws std::bad_alloc.
+    explicit Arena(std::size_t capacity) : capacity_{(capacity + page - 1U) / page * page}
+    {
+      if (this->capacity_ == 0U)
+        return;
+      this->data_.reset(static_cast<std::uint8_t *>(std::aligned_alloc(page, this->capacity_)));
+      if (this->data_ == nullptr)
+        throw std::bad_alloc();
+      madvise(this->data_.get(), this->capacity_, MADV_HUGEPAGE);
+    }
+
+    Arena(const Arena &)                     = delete;
+    auto operator=(const Arena &) -> Arena & = delete;
+
+    // count default-initialized values, aligned to a cache line. Throws std::bad_alloc when the arena is full.
+    template<class T>
+    [[nodiscard]] auto allocate(std::size_t count) -> T *
+    {
+      static_assert(std::is_trivially_destructible_v<T> && alignof(T) <= alignment, "Arena memory is never destroyed and aligned to a cache line");
+      const std::size_t size = (count * sizeof(T) + alignment - 1U) / alignment * alignment;
+      if (count > this->capacity_ / sizeof(T) || size > this->capacity_ - this->used_)
+        throw std::bad_alloc();
+      T *values = reinterpret_cast<T *>(this->data_.get() + this->used_);
+      std::uninitialized_default_construct_n(values, count);
+      this->used_ += size;
+      return values;
+    }
+
+    // Every pointer handed out so far dangles afterwards
+    auto reset() noexcept -> void { this->used_ = 0U; }
+
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return this->capacity_; }
+    [[nodiscard]] auto used() const noexcept -> std::size_t { return this->used_; }
+
+    // Capacity for count values of T aligned as allocate() does
+    template<class T>
+    [[nodiscard]] static constexpr auto bytes(std::size_t count) noexcept -> std::size_t { return (count * sizeof(T) + alignment - 1U) / alignment * alignment; }
+
+  private:
+    static constexpr std::size_t page = std::size_t{1} << 21U;
+
+    struct Free
+    {
+      auto operator()(std::uint8_t *data) const noexcept -> void { std::free(data); }
+    };
+
+    std::size_t                         capacity_;
+    std::size_t                         used_{};
+    std::unique_ptr<std::uint8_t, Free> data_;
+  };
+} // namespace enmach
+
+#endif // ENMACH_ARENA_HPP_
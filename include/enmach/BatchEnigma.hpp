@@ -0,0 +1,210 @@
+#ifndef ENMACH_BATCHENIGMA_HPP_
+#define ENMACH_BATCHENIGMA_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "enmach/DynamicEnigma.hpp"
+#include "enmach/Rotor.hpp"
+#include "enmach/Steckerbrett.hpp"
+#include "enmach/common.hpp"
+#include "enmach/input.hpp"
+#include "enmach/simd.hpp"
+#include "enmach/stepping.hpp"
+
+namespace enmach
+{
+  // Many messages under one day key (rotor order, ring settings, plugboard), each from its own initial position.
+  // Every SIMD lane is a separate message: the rotor offsets of all lanes are stored side by side and stepped together,
+  // so one pass through the shared wiring tables substitutes the next letter of 16 or 32 messages. A lane that reaches
+  // the end of its message takes the next one, longest first, so ragged lengths do not leave lanes idle.
+  class BatchEnigma
+  {
+  public:
+    struct Message
+    {
+      std::string_view text;
+      // one letter per rotor, left to right
+      std::string_view grundstellung;
+      // text.size() letters are written
+      char *output;
+    };
+
+    // Same arguments as DynamicEnigma without the initial position
+    BatchEnigma(Model model, ReflectorId reflector, const std::vector<RotorId> &rotors, std::string_view ringstellung, std::string_view plugs = {})
+        : rotor_count{model == Model::M4 ? 4U : 3U}
+    {
+      detail::validate_key(model, reflector, rotors);
+      if (ringstellung.size() != this->rotor_count)
+        throw std::invalid_argument("Expected one ring setting and one initial position per rotor");
+
+      for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+      {
+        const auto &wiring    = detail::rotor_wirings[static_cast<std::size_t>(rotors[rotor])];
+        this->forward[rotor]  = wiring.forward;
+        this->inverse[rotor]  = wiring.inverse;
+        this->rings[rotor]    = detail::letter_index(ringstellung[rotor]);
+        std::copy(wiring.fvalue->begin(), wiring.fvalue->end(), this->tables.forward[rotor]);
+        std::copy(wiring.rvalue->begin(), wiring.rvalue->end(), this->tables.inverse[rotor]);
+      }
+      const auto &reflector_value = *detail::reflector_wirings[static_cast<std::size_t>(reflector)].value;
+      std::copy(reflector_value.begin(), reflector_value.end(), this->tables.reflector);
+      const Steckerbrett::Table plugboard = Steckerbrett(plugs).table();
+      std::copy(plugboard.begin(), plugboard.end(), this->tables.plugboard);
+      this->tables.rotors = this->rotor_count;
+
+      const std::size_t left = this->rotor_count - 3U;
+      this->notches          = {detail::notches_of(rotors[left + 1U], this->rings[left + 1U]), detail::notches_of(rotors[left + 2U], this->rings[left + 2U])};
+      for (std::uint8_t offset{}; offset < ETW.size(); ++offset)
+      {
+        this->notch_tables.middle[offset] = at_notch(this->notches.middle, offset) ? 0xffU : 0U;
+        this->notch_tables.right[offset]  = at_notch(this->notches.right, offset) ? 0xffU : 0U;
+      }
+    }
+
+    // Each output is what a DynamicEnigma set to the message's grundstellung writes for transform(text). Messages hold
+    // letters only, anything else throws std::invalid_argument before any output is written.
+    auto transform(const std::vector<Message> &messages, simd::Isa isa = simd::Isa::AVX2) const -> void
+    {
+      std::vector<std::array<std::uint8_t, 4>> starts(messages.size());
+      for (std::size_t message{}; message < messages.size(); ++message)
+      {
+        const Message &current = messages[message];
+        if (current.grundstellung.size() != this->rotor_count)
+          throw std::invalid_argument("Expected one ring setting and one initial position per rotor");
+        for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+          starts[message][rotor] = static_cast<std::uint8_t>((detail::letter_index(current.grundstellung[rotor]) + ETW.size() - this->rings[rotor]) % ETW.size());
+        if (input::count_letters(current.text.data(), current.text.data() + current.text.size()) != current.text.size())
+          throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
+      }
+
+      // longest first, empty messages are never handed to a lane
+      std::vector<std::size_t> order(messages.size());
+      std::iota(order.begin(), order.end(), std::size_t{});
+      std::stable_sort(order.begin(), order.end(), [&messages](std::size_t lhs, std::size_t rhs) { return messages[lhs].text.size() > messages[rhs].text.size(); });
+      while (!order.empty() && messages[order.back()].text.empty())
+        order.pop_back();
+
+      isa = std::min(isa, simd::detected());
+      if (isa == simd::Isa::Scalar)
+        for (const std::size_t message : order)
+          this->transform_scalar(messages[message], starts[message]);
+      else
+        this->transform_lanes(messages, starts, order, isa);
+    }
+
+  private:
+    auto transform_lanes(const std::vector<Message> &messages, const std::vector<std::array<std::uint8_t, 4>> &starts, const std::vector<std::size_t> &order, simd::Isa isa) const -> void
+    {
+      const std::size_t lanes = simd::lanes(isa);
+      const std::size_t left  = this->rotor_count - 3U;
+
+      // idle lanes read and write a single dummy letter, their index mask is 0 instead of all ones
+      const char                   idle_source[1] = {'a'};
+      char                         idle_target[1]{};
+      std::array<const char *, 32> source{};
+      std::array<char *, 32>       target{};
+      std::array<std::size_t, 32>  remaining{};
+      std::array<std::size_t, 32>  mask{};
+      simd::Offsets                offsets{};
+      std::size_t                  next{};
+      std::size_t                  active{};
+
+      const auto assign = [&](std::size_t lane) {
+        if (next == order.size())
+        {
+          source[lane]    = idle_source;
+          target[lane]    = idle_target;
+          remaining[lane] = std::numeric_limits<std::size_t>::max();
+          mask[lane]      = 0U;
+          return;
+        }
+        const std::size_t message = order[next++];
+        source[lane]              = messages[message].text.data();
+        target[lane]              = messages[message].output;
+        remaining[lane]           = messages[message].text.size();
+        mask[lane]                = ~std::size_t{};
+        for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+          offsets.value[rotor][lane] = starts[message][rotor];
+        ++active;
+      };
+      for (std::size_t lane{}; lane < lanes; ++lane)
+        assign(lane);
+
+      alignas(32) char column[32]{};
+      alignas(32) char result[32]{};
+      while (active != 0U)
+      {
+        // lockstep until the shortest message in flight ends
+        const std::size_t run = *std::min_element(remaining.begin(), remaining.begin() + static_cast<std::ptrdiff_t>(lanes));
+        for (std::size_t press{}; press < run; ++press)
+        {
+          simd::step(isa, this->notch_tables, offsets, left);
+          for (std::size_t lane{}; lane < lanes; ++lane)
+            column[lane] = source[lane][press & mask[lane]];
+          simd::substitute(isa, this->tables, offsets, column, result);
+          for (std::size_t lane{}; lane < lanes; ++lane)
+            target[lane][press & mask[lane]] = result[lane];
+        }
+
+        for (std::size_t lane{}; lane < lanes; ++lane)
+        {
+          if (mask[lane] == 0U)
+            continue;
+          source[lane] += run;
+          target[lane] += run;
+          remaining[lane] -= run;
+          if (remaining[lane] == 0U)
+          {
+            --active;
+            assign(lane);
+          }
+        }
+      }
+    }
+
+    auto transform_scalar(const Message &message, const std::array<std::uint8_t, 4> &start) const noexcept -> void
+    {
+      const std::size_t           left    = this->rotor_count - 3U;
+      std::array<std::uint8_t, 4> offsets = start;
+      Odometer                    odometer{start[left], start[left + 1U], start[left + 2U]};
+      for (std::size_t letter{}; letter < message.text.size(); ++letter)
+      {
+        step(odometer, this->notches);
+        offsets[left]          = odometer.left;
+        offsets[left + 1U]     = odometer.middle;
+        offsets[left + 2U]     = odometer.right;
+        message.output[letter] = static_cast<char>('a' + this->substitute(offsets, to_index(message.text[letter])));
+      }
+    }
+
+    // Scalar twin of simd::substitute on the pre-shifted wiring tables
+    [[nodiscard]] auto substitute(const std::array<std::uint8_t, 4> &offsets, std::uint8_t index) const noexcept -> std::uint8_t
+    {
+      index = this->tables.plugboard[index];
+      for (std::size_t rotor = this->rotor_count; rotor-- > 0U;)
+        index = (*this->forward[rotor])[offsets[rotor]][index];
+      index = this->tables.reflector[index];
+      for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+        index = (*this->inverse[rotor])[offsets[rotor]][index];
+      return this->tables.plugboard[index];
+    }
+
+    std::size_t                                       rotor_count;
+    std::array<std::uint8_t, 4>                       rings{};
+    std::array<const rotor_engine::ShiftedWiring *, 4> forward{};
+    std::array<const rotor_engine::ShiftedWiring *, 4> inverse{};
+    simd::Tables                                      tables{};
+    simd::NotchTables                                 notch_tables{};
+    Notches                                           notches{};
+  };
+} // namespace enmach
+
+#endif // ENMACH_BATCHENIGMA_HPP_
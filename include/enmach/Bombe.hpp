@@ -0,0 +1,353 @@
+#ifndef ENMACH_BOMBE_HPP_
+#define ENMACH_BOMBE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "enmach/CompiledKey.hpp"
+#include "enmach/common.hpp"
+#include "enmach/input.hpp"
+#include "enmach/parallel.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  // A crib compiled into the graph the bombe is wired from: one node per letter, one edge per crib letter joining the
+  // plaintext and ciphertext letters through the scrambler at that position.
+  class Menu
+  {
+  public:
+    struct Edge
+    {
+      std::uint8_t plain;
+      std::uint8_t cipher;
+      // key presses from the message start to this letter, including its own
+      std::uint64_t step;
+    };
+
+    // crib and ciphertext are the same length, position is the number of letters before the crib in the message.
+    // Throws std::invalid_argument on non-letters, different lengths or a letter enciphered to itself (the crib
+    // cannot be at this position).
+    Menu(std::string_view crib, std::string_view ciphertext, std::uint64_t position = 0U)
+    {
+      if (crib.size() != ciphertext.size() || crib.empty())
+        throw std::invalid_argument("Crib and ciphertext must be non-empty and of the same length");
+      for (std::size_t letter{}; letter < crib.size(); ++letter)
+      {
+        const std::uint8_t plain  = detail::letter_index(crib[letter]);
+        const std::uint8_t cipher = detail::letter_index(ciphertext[letter]);
+        if (plain == cipher)
+          throw std::invalid_argument("Enigma never enciphers a letter to itself, the crib does not fit here");
+        this->edges_.push_back({plain, cipher, position + letter + 1U});
+      }
+
+      std::array<std::size_t, 26> degree{};
+      for (const Edge &edge : this->edges_)
+      {
+        ++degree[edge.plain];
+        ++degree[edge.cipher];
+      }
+      // the most connected letter lights up the most of the menu from a single hypothesis
+      this->test_letter = static_cast<std::uint8_t>(std::max_element(degree.begin(), degree.end()) - degree.begin());
+
+      // adjacency of every letter, both directions of an edge
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+      {
+        this->first[letter] = static_cast<std::uint16_t>(this->links.size());
+        for (std::size_t edge{}; edge < this->edges_.size(); ++edge)
+        {
+          if (this->edges_[edge].plain == letter)
+            this->links.push_back({this->edges_[edge].cipher, static_cast<std::uint16_t>(edge)});
+          if (this->edges_[edge].cipher == letter)
+            this->links.push_back({this->edges_[edge].plain, static_cast<std::uint16_t>(edge)});
+        }
+      }
+      this->first[ETW.size()] = static_cast<std::uint16_t>(this->links.size());
+    }
+
+    [[nodiscard]] auto edges() const noexcept -> const std::vector<Edge> & { return this->edges_; }
+
+    [[nodiscard]] auto testLetter() const noexcept -> char { return static_cast<char>('A' + this->test_letter); }
+
+    // Independent cycles of the graph, the more loops the fewer false stops
+    [[nodiscard]] auto loops() const noexcept -> std::size_t
+    {
+      std::array<std::uint8_t, 26> parent{};
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+        parent[letter] = letter;
+      const auto root = [&parent](std::uint8_t letter) {
+        while (parent[letter] != letter)
+          letter = parent[letter] = parent[parent[letter]];
+        return letter;
+      };
+      std::size_t loops{};
+      for (const Edge &edge : this->edges_)
+      {
+        const std::uint8_t plain  = root(edge.plain);
+        const std::uint8_t cipher = root(edge.cipher);
+        if (plain == cipher)
+          ++loops;
+        else
+          parent[plain] = cipher;
+      }
+      return loops;
+    }
+
+  private:
+    friend class Bombe;
+
+    struct Link
+    {
+      std::uint8_t  letter;
+      std::uint16_t edge;
+    };
+
+    std::vector<Edge>             edges_;
+    std::uint8_t                  test_letter{};
+    std::array<std::uint16_t, 27> first{};
+    std::vector<Link>             links;
+  };
+
+  // Turing-Welchman bombe with the diagonal board. For every rotor order and rotor position it assumes a plug partner
+  // for the test letter of the menu, lets the consequences spread through the scramblers of the menu edges and the
+  // diagonal board (a plugged to b implies b plugged to a) and stops where the closure does not light up all 26
+  // partners. Every stop is then checked like on the checking machine: only closures that plug no letter twice are
+  // reported. Like the original bombe it assumes the middle and left rotors stand still over the crib, so the crib
+  // should not cross a turnover of the middle rotor.
+  class Bombe
+  {
+  public:
+    struct Stop
+    {
+      // left to right, Zusatzwalze first on the M4
+      std::vector<RotorId> rotors;
+      ReflectorId          reflector;
+      // rotor offsets (position minus ring setting) at the message start, left to right: the Grundstellung with all
+      // rings at A
+      std::string          offsets;
+      // plug pairs implied by the menu, "AV BS CG"; letters outside the menu are unknown
+      std::string          plugs;
+    };
+
+    explicit Bombe(Menu menu) : menu_{std::move(menu)} {}
+
+    Bombe(std::string_view crib, std::string_view ciphertext, std::uint64_t position = 0U) : Bombe(Menu(crib, ciphertext, position)) {}
+
+    [[nodiscard]] auto menu() const noexcept -> const Menu & { return this->menu_; }
+
+    // Every rotor order the model allows: 60 on the M1, 336 on the M3 and 672 on the M4 (BETA or GAMMA in front)
+    [[nodiscard]] static auto orders(Model model) -> std::vector<std::vector<RotorId>>
+    {
+      const std::size_t              rotors = model == Model::M1 ? 5U : 8U;
+      std::vector<std::vector<RotorId>> orders;
+      for (const RotorId zusatzwalze : {RotorId::BETA, RotorId::GAMMA})
+      {
+        for (std::size_t left{}; left < rotors; ++left)
+          for (std::size_t middle{}; middle < rotors; ++middle)
+            for (std::size_t right{}; right < rotors; ++right)
+            {
+              if (left == middle || middle == right || left == right)
+                continue;
+              std::vector<RotorId> order = {static_cast<RotorId>(left), static_cast<RotorId>(middle), static_cast<RotorId>(right)};
+              if (model == Model::M4)
+                order.insert(order.begin(), zusatzwalze);
+              orders.push_back(std::move(order));
+            }
+        if (model != Model::M4)
+          break;
+      }
+      return orders;
+    }
+
+    [[nodiscard]] auto run(Model model, ReflectorId reflector, std::size_t threads = std::thread::hardware_concurrency()) const -> std::vector<Stop>
+    {
+      return this->run(model, reflector, orders(model), threads);
+    }
+
+    // Stops of the given rotor orders sorted by order and offsets. Orders and reflector are checked as by
+    // DynamicEnigma (std::invalid_argument), the orders are spread across threads with work stealing.
+    [[nodiscard]] auto run(Model model, ReflectorId reflector, const std::vector<std::vector<RotorId>> &orders, std::size_t threads = std::thread::hardware_concurrency()) const -> std::vector<Stop>
+    {
+      for (const auto &order : orders)
+        detail::validate_key(model, reflector, order);
+      if (orders.empty())
+        return {};
+
+      // one item per rotor order and offset of the leftmost rotor
+      const std::size_t        items = orders.size() * ETW.size();
+      threads                        = std::max<std::size_t>(1U, std::min(threads, items));
+      detail::WorkRanges       work(items, threads);
+      std::vector<std::vector<Stop>> found(threads);
+      const auto                     run = [this, reflector, &orders, &work, &found](std::size_t worker) {
+        while (const auto item = work.next(worker))
+          this->search(orders[*item / ETW.size()], reflector, static_cast<std::uint8_t>(*item % ETW.size()), found[worker]);
+      };
+
+      detail::run_workers(threads, run);
+
+      std::vector<Stop> stops;
+      for (auto &stops_of_worker : found)
+        stops.insert(stops.end(), stops_of_worker.begin(), stops_of_worker.end());
+      std::sort(stops.begin(), stops.end(), [](const Stop &lhs, const Stop &rhs) { return std::tie(lhs.rotors, lhs.offsets, lhs.plugs) < std::tie(rhs.rotors, rhs.offsets, rhs.plugs); });
+      return stops;
+    }
+
+  private:
+    // rows[letter] has bit partner set when letter is hypothetically plugged to partner
+    using Rows = std::array<std::uint32_t, 26>;
+
+    // A link of the menu with the scrambler of its edge at the position under test
+    struct Wire
+    {
+      std::uint8_t        letter;
+      const std::uint8_t *scrambler;
+    };
+    using Wires = std::vector<Wire>;
+
+    static constexpr std::uint32_t all_letters = (std::uint32_t{1} << 26U) - 1U;
+
+    // Every position of one rotor order whose leftmost rotor stands at leftmost
+    auto search(const std::vector<RotorId> &order, ReflectorId reflector, std::uint8_t leftmost, std::vector<Stop> &stops) const -> void
+    {
+      const std::size_t rotors = order.size();
+      const auto       &right  = detail::rotor_wirings[static_cast<std::size_t>(order[rotors - 1U])];
+      const auto       &value  = *detail::reflector_wirings[static_cast<std::size_t>(reflector)].value;
+
+      // offsets of the rotors left of the rightmost one, leftmost fixed by the work item
+      const std::size_t           inner = rotors == 4U ? 26U * 26U : 26U;
+      std::array<std::uint8_t, 4> offsets{leftmost};
+      std::array<std::array<std::uint8_t, 26>, 26> scramblers{};
+      std::vector<std::uint8_t>                    turns(this->menu_.links.size());
+      for (std::size_t link{}; link < turns.size(); ++link)
+        turns[link] = static_cast<std::uint8_t>(this->menu_.edges_[this->menu_.links[link].edge].step % ETW.size());
+      Wires wires(this->menu_.links.size());
+      for (std::size_t position{}; position < inner; ++position)
+      {
+        if (rotors == 4U)
+        {
+          offsets[1] = static_cast<std::uint8_t>(position / 26U);
+          offsets[2] = static_cast<std::uint8_t>(position % 26U);
+        }
+        else
+          offsets[1] = static_cast<std::uint8_t>(position);
+
+        // the same core for the whole crib, only the rightmost rotor turns
+        std::array<std::uint8_t, 26> core{};
+        for (std::uint8_t index{}; index < ETW.size(); ++index)
+        {
+          std::uint8_t contact = index;
+          for (std::size_t rotor = rotors - 1U; rotor-- > 0U;)
+            contact = (*detail::rotor_wirings[static_cast<std::size_t>(order[rotor])].forward)[offsets[rotor]][contact];
+          contact = value[contact];
+          for (std::size_t rotor{}; rotor < rotors - 1U; ++rotor)
+            contact = (*detail::rotor_wirings[static_cast<std::size_t>(order[rotor])].inverse)[offsets[rotor]][contact];
+          core[index] = contact;
+        }
+        for (std::uint8_t offset{}; offset < ETW.size(); ++offset)
+          for (std::uint8_t index{}; index < ETW.size(); ++index)
+            scramblers[offset][index] = (*right.inverse)[offset][core[(*right.forward)[offset][index]]];
+
+        for (std::uint8_t offset{}; offset < ETW.size(); ++offset)
+        {
+          for (std::size_t link{}; link < wires.size(); ++link)
+            wires[link] = {this->menu_.links[link].letter, scramblers[(offset + turns[link]) % ETW.size()].data()};
+          offsets[rotors - 1U] = offset;
+          this->test(order, reflector, offsets, wires, stops);
+        }
+      }
+    }
+
+    auto test(const std::vector<RotorId> &order, ReflectorId reflector, const std::array<std::uint8_t, 4> &offsets, const Wires &wires, std::vector<Stop> &stops) const -> void
+    {
+      const std::uint8_t test_letter = this->menu_.test_letter;
+      Rows               rows{};
+      // any hypothesis will do: a wrong one lights up every partner but the right one, the right one only itself
+      const std::uint32_t lit = this->closure(wires, test_letter, 0U, rows, true);
+      if (lit == all_letters)
+        return;
+
+      std::uint32_t candidates = all_letters & ~lit;
+      if (input::detail::population_count(lit) == 1U)
+        candidates |= lit;
+      for (; candidates != 0U; candidates &= candidates - 1U)
+      {
+        const auto partner = static_cast<std::uint8_t>(input::detail::trailing_zeros(candidates));
+        this->closure(wires, test_letter, partner, rows, false);
+        if (std::all_of(rows.begin(), rows.end(), [](std::uint32_t row) { return (row & (row - 1U)) == 0U; }))
+          stops.push_back(this->stop(order, reflector, offsets, rows));
+      }
+    }
+
+    // Spreads the hypothesis letter -> partner over the menu and the diagonal board, returns the row of the test letter.
+    // Rows travel as bitsets, each letter passes on only the partners it gained since its last turn. With give_up the
+    // spreading ends as soon as the row of the test letter is full.
+    auto closure(const Wires &wires, std::uint8_t letter, std::uint8_t partner, Rows &rows, bool give_up) const noexcept -> std::uint32_t
+    {
+      const std::uint8_t test_letter = this->menu_.test_letter;
+      Rows               passed{};
+      rows.fill(0U);
+      rows[letter]         = std::uint32_t{1} << partner;
+      std::uint32_t dirty = std::uint32_t{1} << letter;
+      while (dirty != 0U)
+      {
+        const auto          from  = static_cast<std::uint8_t>(input::detail::trailing_zeros(dirty));
+        const std::uint32_t delta = rows[from] & ~passed[from];
+        passed[from]              = rows[from];
+        dirty &= dirty - 1U;
+
+        // diagonal board
+        for (std::uint32_t bits = delta; bits != 0U; bits &= bits - 1U)
+        {
+          const auto to = static_cast<std::uint8_t>(input::detail::trailing_zeros(bits));
+          rows[to] |= std::uint32_t{1} << from;
+          dirty |= static_cast<std::uint32_t>((rows[to] & ~passed[to]) != 0U) << to;
+        }
+        for (std::uint16_t link = this->menu_.first[from]; link < this->menu_.first[from + 1U]; ++link)
+        {
+          std::uint32_t scrambled{};
+          for (std::uint32_t bits = delta; bits != 0U; bits &= bits - 1U)
+            scrambled |= std::uint32_t{1} << wires[link].scrambler[input::detail::trailing_zeros(bits)];
+          const std::uint8_t to = wires[link].letter;
+          rows[to] |= scrambled;
+          dirty |= static_cast<std::uint32_t>((rows[to] & ~passed[to]) != 0U) << to;
+        }
+        if (give_up && rows[test_letter] == all_letters)
+          break;
+      }
+      return rows[test_letter];
+    }
+
+    [[nodiscard]] static auto stop(const std::vector<RotorId> &order, ReflectorId reflector, const std::array<std::uint8_t, 4> &offsets, const Rows &rows) -> Stop
+    {
+      Stop stop{order, reflector, {}, {}};
+      for (std::size_t rotor{}; rotor < order.size(); ++rotor)
+        stop.offsets += static_cast<char>('A' + offsets[rotor]);
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+      {
+        if (rows[letter] == 0U)
+          continue;
+        const auto partner = static_cast<std::uint8_t>(input::detail::trailing_zeros(rows[letter]));
+        if (partner <= letter)
+          continue;
+        if (!stop.plugs.empty())
+          stop.plugs += ' ';
+        stop.plugs += static_cast<char>('A' + letter);
+        stop.plugs += static_cast<char>('A' + partner);
+      }
+      return stop;
+    }
+
+    Menu menu_;
+  };
+} // namespace enmach
+
+#endif // ENMACH_BOMBE_HPP_
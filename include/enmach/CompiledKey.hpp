@@ -0,0 +1,384 @@
+#ifndef ENMACH_COMPILEDKEY_HPP_
+#define ENMACH_COMPILEDKEY_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "enmach/PackedState.hpp"
+#include "enmach/Reflector.hpp"
+#include "enmach/Rotor.hpp"
+#include "enmach/Steckerbrett.hpp"
+#include "enmach/StepSequence.hpp"
+#include "enmach/common.hpp"
+#include "enmach/input.hpp"
+#include "enmach/simd.hpp"
+#include "enmach/stepping.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  enum class Model : std::uint8_t
+  {
+    M1,
+    M3,
+    M4
+  };
+
+  // clang-format off
+  enum class RotorId : std::uint8_t { I, II, III, IV, V, VI, VII, VIII, BETA, GAMMA };
+  enum class ReflectorId : std::uint8_t { A, B, C, ThinB, ThinC };
+  // clang-format on
+
+  namespace detail
+  {
+    // Runtime handles on the wiring of a rotor_tags type
+    struct RotorWiring
+    {
+      std::string_view                      name;
+      const rotor_engine::ShiftedWiring    *forward;
+      const rotor_engine::ShiftedWiring    *inverse;
+      const std::array<std::uint8_t, 26>   *fvalue;
+      const std::array<std::uint8_t, 26>   *rvalue;
+      bool                                (*turn)(std::uint8_t);
+    };
+
+    template<class RotorTag>
+    [[nodiscard]] constexpr auto make_rotor_wiring(std::string_view name) noexcept -> RotorWiring
+    {
+      return {name, &rotor_engine::forward_table<RotorTag>, &rotor_engine::inverse_table<RotorTag>, &RotorTag::fvalue, &RotorTag::rvalue, &RotorTag::turn};
+    }
+
+    struct ReflectorWiring
+    {
+      std::string_view                    name;
+      const std::array<std::uint8_t, 26> *value;
+    };
+
+    // Indexed by RotorId and ReflectorId
+    inline constexpr std::array<RotorWiring, 10> rotor_wirings = {
+        make_rotor_wiring<rotor_tags::I>("I"),
+        make_rotor_wiring<rotor_tags::II>("II"),
+        make_rotor_wiring<rotor_tags::III>("III"),
+        make_rotor_wiring<rotor_tags::IV>("IV"),
+        make_rotor_wiring<rotor_tags::V>("V"),
+        make_rotor_wiring<rotor_tags::VI>("VI"),
+        make_rotor_wiring<rotor_tags::VII>("VII"),
+        make_rotor_wiring<rotor_tags::VIII>("VIII"),
+        make_rotor_wiring<rotor_tags::BETA>("BETA"),
+        make_rotor_wiring<rotor_tags::GAMMA>("GAMMA")};
+
+    inline constexpr std::array<ReflectorWiring, 5> reflector_wirings = {{{"A", &ukw::A::value}, {"B", &ukw::B::value}, {"C", &ukw::C::value}, {"ThinB", &ukw::ThinB::value}, {"ThinC", &ukw::ThinC::value}}};
+
+    [[nodiscard]] constexpr auto equals_ignore_case(std::string_view lhs, std::string_view rhs) noexcept -> bool
+    {
+      if (lhs.size() != rhs.size())
+        return false;
+      for (std::size_t i{}; i < lhs.size(); ++i)
+        if ((is_letter(lhs[i]) ? to_lowercase(lhs[i]) : lhs[i]) != (is_letter(rhs[i]) ? to_lowercase(rhs[i]) : rhs[i]))
+          return false;
+      return true;
+    }
+
+    [[nodiscard]] inline auto letter_index(char letter) -> std::uint8_t
+    {
+      if (!is_letter(letter))
+        throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
+      return static_cast<std::uint8_t>(to_lowercase(letter) - 'a');
+    }
+
+    // Turnover notches of a rotor as a bit mask over its effective offsets
+    [[nodiscard]] inline auto notches_of(RotorId rotor, std::uint8_t ringstellung) noexcept -> std::uint32_t
+    {
+      std::uint32_t result{};
+      for (std::uint8_t offset{}; offset < ETW.size(); ++offset)
+        if (rotor_wirings[static_cast<std::size_t>(rotor)].turn(static_cast<std::uint8_t>((offset + ringstellung) % ETW.size())))
+          result |= 1U << offset;
+      return result;
+    }
+
+    // Throws std::invalid_argument on rotors or a reflector the model does not allow
+    inline auto validate_key(Model model, ReflectorId reflector, const std::vector<RotorId> &rotors) -> void
+    {
+      if (rotors.size() != (model == Model::M4 ? 4U : 3U))
+        throw std::invalid_argument("Expected number of rotors and obtained number of rotors mismatch");
+      for (std::size_t rotor{}; rotor < rotors.size(); ++rotor)
+      {
+        if (std::find(rotors.begin(), rotors.begin() + static_cast<std::ptrdiff_t>(rotor), rotors[rotor]) != rotors.begin() + static_cast<std::ptrdiff_t>(rotor))
+          throw std::invalid_argument("Rotors must be unique");
+        const bool zusatzwalze = rotors[rotor] == RotorId::BETA || rotors[rotor] == RotorId::GAMMA;
+        if (zusatzwalze != (model == Model::M4 && rotor == 0U))
+          throw std::invalid_argument("BETA and GAMMA are reserved for the Zusatzwalze position of the M4");
+        if (model == Model::M1 && rotors[rotor] > RotorId::V)
+          throw std::invalid_argument("All rotors must belong to the allowed set for this machine");
+      }
+      const bool thin = reflector == ReflectorId::ThinB || reflector == ReflectorId::ThinC;
+      if (thin != (model == Model::M4))
+        throw std::invalid_argument("Reflector must belong to the allowed set for this machine");
+    }
+  } // namespace detail
+
+  // Case-insensitive lookups for keys read at runtime ("M4", "VIII", "ThinB"), std::invalid_argument on unknown names
+  [[nodiscard]] inline auto model_from_name(std::string_view name) -> Model
+  {
+    constexpr std::array<std::string_view, 3> names = {"M1", "M3", "M4"};
+    for (std::size_t i{}; i < names.size(); ++i)
+      if (detail::equals_ignore_case(name, names[i]))
+        return static_cast<Model>(i);
+    throw std::invalid_argument("Unknown Enigma model");
+  }
+
+  [[nodiscard]] inline auto rotor_from_name(std::string_view name) -> RotorId
+  {
+    for (std::size_t i{}; i < detail::rotor_wirings.size(); ++i)
+      if (detail::equals_ignore_case(name, detail::rotor_wirings[i].name))
+        return static_cast<RotorId>(i);
+    throw std::invalid_argument("Unknown rotor");
+  }
+
+  [[nodiscard]] inline auto reflector_from_name(std::string_view name) -> ReflectorId
+  {
+    for (std::size_t i{}; i < detail::reflector_wirings.size(); ++i)
+      if (detail::equals_ignore_case(name, detail::reflector_wirings[i].name))
+        return static_cast<ReflectorId>(i);
+    throw std::invalid_argument("Unknown reflector");
+  }
+
+  // Where a machine running on a CompiledKey stands: the effective offset of every rotor, nothing else
+  struct Cursor
+  {
+    PackedState state;
+  };
+
+  [[nodiscard]] constexpr auto operator==(Cursor lhs, Cursor rhs) noexcept -> bool { return lhs.state == rhs.state; }
+
+  [[nodiscard]] constexpr auto operator!=(Cursor lhs, Cursor rhs) noexcept -> bool { return lhs.state != rhs.state; }
+
+  // Everything about a key that does not change while typing: wiring and plugboard tables, SIMD tables, notch schedule
+  // and initial position. It is never modified after construction, so any number of threads can share one instance
+  // and keep their own 4-byte Cursor each.
+  class CompiledKey
+  {
+  public:
+    // rotors are ordered left to right (Zusatzwalze first on the M4), ringstellung and grundstellung hold one letter per
+    // rotor in the same order and plugs holds up to 13 letter pairs, optionally separated by spaces ("AV BS CG").
+    // Combinations the model does not allow throw std::invalid_argument, as the template machine fails to compile.
+    CompiledKey(Model model, ReflectorId reflector, const std::vector<RotorId> &rotors, std::string_view ringstellung, std::string_view grundstellung, std::string_view plugs = {})
+        : model_{model}, rotor_count{model == Model::M4 ? 4U : 3U}
+    {
+      detail::validate_key(model, reflector, rotors);
+      if (ringstellung.size() != this->rotor_count || grundstellung.size() != this->rotor_count)
+        throw std::invalid_argument("Expected one ring setting and one initial position per rotor");
+
+      std::array<std::uint8_t, 4> offsets{};
+      std::array<std::uint8_t, 4> rings{};
+      for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+      {
+        const auto &wiring    = detail::rotor_wirings[static_cast<std::size_t>(rotors[rotor])];
+        this->forward[rotor]  = wiring.forward;
+        this->inverse[rotor]  = wiring.inverse;
+        rings[rotor]          = detail::letter_index(ringstellung[rotor]);
+        offsets[rotor]        = static_cast<std::uint8_t>((detail::letter_index(grundstellung[rotor]) + ETW.size() - rings[rotor]) % ETW.size());
+        std::copy(wiring.fvalue->begin(), wiring.fvalue->end(), this->tables.forward[rotor]);
+        std::copy(wiring.rvalue->begin(), wiring.rvalue->end(), this->tables.inverse[rotor]);
+      }
+      this->reflector = detail::reflector_wirings[static_cast<std::size_t>(reflector)].value;
+      std::copy(this->reflector->begin(), this->reflector->end(), this->tables.reflector);
+      this->tables.rotors = this->rotor_count;
+
+      const std::size_t left = this->rotor_count - 3U;
+      this->notches_         = {detail::notches_of(rotors[left + 1U], rings[left + 1U]), detail::notches_of(rotors[left + 2U], rings[left + 2U])};
+      this->origin           = pack({offsets[left], offsets[left + 1U], offsets[left + 2U]}, left == 1U ? offsets[0] : std::uint8_t{});
+
+      this->plugboard = Steckerbrett(plugs).table();
+      std::copy(this->plugboard.begin(), this->plugboard.end(), this->tables.plugboard);
+    }
+
+    [[nodiscard]] auto model() const noexcept -> Model { return this->model_; }
+    [[nodiscard]] auto rotors() const noexcept -> std::size_t { return this->rotor_count; }
+    [[nodiscard]] auto notches() const noexcept -> const Notches & { return this->notches_; }
+
+    // At the initial position, or position key presses after it (in constant time)
+    [[nodiscard]] auto cursor(std::uint64_t position = 0U) const noexcept -> Cursor
+    {
+      Cursor cursor{this->origin};
+      this->advance(cursor, position);
+      return cursor;
+    }
+
+    // Throws std::invalid_argument unless state holds an offset for each rotor of this key
+    [[nodiscard]] auto cursor(PackedState state) const -> Cursor
+    {
+      if (!is_valid(state) || (this->rotor_count == 3U && zusatzwalze(state) != 0U))
+        throw std::invalid_argument("Packed state does not hold an offset for each rotor");
+      return {state};
+    }
+
+    auto advance(Cursor &cursor, std::uint64_t count) const noexcept -> void
+    {
+      Odometer odometer = unpack(cursor.state);
+      enmach::advance(odometer, this->notches_, count);
+      cursor.state = pack(odometer, zusatzwalze(cursor.state));
+    }
+
+    auto increment(Cursor &cursor) const noexcept -> void { this->advance(cursor, 1U); }
+
+    // Substitution at the cursor, without stepping (the cursor API has no core cache, every rotor is looked up)
+    [[nodiscard]] auto exec(Cursor cursor, char letter) const -> char
+    {
+      const auto   offsets = this->offsets(unpack(cursor.state), zusatzwalze(cursor.state));
+      std::uint8_t index   = this->plugboard[detail::letter_index(letter)];
+      for (std::size_t rotor = this->rotor_count; rotor-- > 0U;)
+        index = (*this->forward[rotor])[offsets[rotor]][index];
+      index = (*this->reflector)[index];
+      for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+        index = (*this->inverse[rotor])[offsets[rotor]][index];
+      return static_cast<char>('a' + this->plugboard[index]);
+    }
+
+    // Same contract as DynamicEnigma::transform, the cursor moves past the letters
+    template<class Input = input::Strict>
+    auto transform(Cursor &cursor, const char *first, const char *last, char *output, simd::Isa isa = simd::Isa::AVX2) const -> char *
+    {
+      State        state = this->state(cursor.state);
+      NotchStepper stepper{state.odometer, this->notches_};
+      char        *end = input::transform<Input>(first, last, output, [this, isa, &state, &stepper](const char *begin, const char *stop, char *out) { this->transform_letters(state, begin, stop, out, isa, stepper); });
+      cursor.state     = pack(state.odometer, state.zusatzwalze);
+      return end;
+    }
+
+    template<class Input = input::Strict>
+    auto transform(Cursor &cursor, std::string_view input, char *output, simd::Isa isa = simd::Isa::AVX2) const -> char * { return this->transform<Input>(cursor, input.data(), input.data() + input.size(), output, isa); }
+
+  private:
+    friend class DecryptionMatrix;
+    friend class DynamicEnigma;
+    friend class PlugboardSearch;
+    friend class TableCache;
+
+    // Rotor offsets of a running machine and the core permutation they imply
+    struct State
+    {
+      Odometer                     odometer{};
+      std::uint8_t                 zusatzwalze{};
+      std::array<std::uint8_t, 26> core{};
+    };
+
+    [[nodiscard]] auto state(PackedState packed) const noexcept -> State
+    {
+      State state{unpack(packed), zusatzwalze(packed), {}};
+      this->rebuild_core(state);
+      return state;
+    }
+
+    // Offsets left to right, Zusatzwalze first on the M4
+    [[nodiscard]] auto offsets(const Odometer &odometer, std::uint8_t zusatzwalze) const noexcept -> std::array<std::uint8_t, 4>
+    {
+      if (this->rotor_count == 4U)
+        return {zusatzwalze, odometer.left, odometer.middle, odometer.right};
+      return {odometer.left, odometer.middle, odometer.right, 0U};
+    }
+
+    // Every rotor but the rightmost one and the reflector as a single permutation, see EnigmaMachine::rebuild_core
+    auto rebuild_core(State &state) const noexcept -> void
+    {
+      if (this->cores != nullptr)
+      {
+        const std::size_t block = (static_cast<std::size_t>(state.zusatzwalze) * 26U + state.odometer.left) * 26U + state.odometer.middle;
+        std::memcpy(state.core.data(), this->cores + block * state.core.size(), state.core.size());
+        return;
+      }
+      const auto        offsets = this->offsets(state.odometer, state.zusatzwalze);
+      const std::size_t right   = this->rotor_count - 1U;
+      for (std::uint8_t index{}; index < state.core.size(); ++index)
+      {
+        std::uint8_t value = index;
+        for (std::size_t rotor = right; rotor-- > 0U;)
+          value = (*this->forward[rotor])[offsets[rotor]][value];
+        value = (*this->reflector)[value];
+        for (std::size_t rotor{}; rotor < right; ++rotor)
+          value = (*this->inverse[rotor])[offsets[rotor]][value];
+        state.core[index] = value;
+      }
+    }
+
+    auto apply(State &state, const StepSequence::State &step) const noexcept -> void
+    {
+      state.odometer = {step.left, step.middle, step.right};
+      if (step.moved)
+        this->rebuild_core(state);
+    }
+
+    [[nodiscard]] auto substitute(const State &state, std::uint8_t index) const noexcept -> std::uint8_t
+    {
+      const std::size_t right = this->rotor_count - 1U;
+      index                   = this->plugboard[index];
+      index                   = (*this->forward[right])[state.odometer.right][index];
+      index                   = state.core[index];
+      index                   = (*this->inverse[right])[state.odometer.right][index];
+      return this->plugboard[index];
+    }
+
+    template<class Stepper>
+    auto transform_letters(State &state, const char *first, const char *last, char *output, simd::Isa isa, Stepper &stepper) const noexcept -> void
+    {
+      isa = std::min(isa, simd::detected());
+      if (isa != simd::Isa::Scalar)
+        this->transform_blocks(state, first, last, output, isa, stepper);
+
+      for (; first != last; ++first, ++output)
+      {
+        this->apply(state, stepper.next());
+        *output = static_cast<char>('a' + this->substitute(state, to_index(*first)));
+      }
+    }
+
+    template<class Stepper>
+    auto transform_blocks(State &state, const char *&first, const char *last, char *&output, simd::Isa isa, Stepper &stepper) const -> void
+    {
+      const auto        lanes = simd::lanes(isa);
+      const std::size_t left  = this->rotor_count - 3U;
+      if (static_cast<std::size_t>(last - first) < lanes)
+        return;
+
+      simd::Offsets offsets{};
+      if (left == 1U)
+        std::fill_n(offsets.value[0], lanes, state.zusatzwalze);
+
+      for (; static_cast<std::size_t>(last - first) >= lanes; first += lanes, output += lanes)
+      {
+        for (std::size_t lane{}; lane < lanes; ++lane)
+        {
+          const StepSequence::State &step = stepper.next();
+          offsets.value[left][lane]       = step.left;
+          offsets.value[left + 1U][lane]  = step.middle;
+          offsets.value[left + 2U][lane]  = step.right;
+        }
+        simd::substitute(isa, this->tables, offsets, first, output);
+      }
+      state.odometer = {offsets.value[left][lanes - 1U], offsets.value[left + 1U][lanes - 1U], offsets.value[left + 2U][lanes - 1U]};
+      this->rebuild_core(state);
+    }
+
+    Model                                             model_;
+    std::size_t                                       rotor_count;
+    std::array<const rotor_engine::ShiftedWiring *, 4> forward{};
+    std::array<const rotor_engine::ShiftedWiring *, 4> inverse{};
+    const std::array<std::uint8_t, 26>               *reflector{};
+    Steckerbrett::Table                               plugboard{};
+    simd::Tables                                      tables{};
+    Notches                                           notches_{};
+    PackedState                                       origin{};
+    // precomputed core permutations from a TableCache, indexed by Zusatzwalze, left and middle offset
+    const std::uint8_t                               *cores{};
+    std::shared_ptr<const void>                       cores_owner;
+  };
+} // namespace enmach
+
+#endif // ENMACH_COMPILEDKEY_HPP_
@@ -0,0 +1,153 @@
+#ifndef ENMACH_DECRYPTIONMATRIX_HPP_
+#define ENMACH_DECRYPTIONMATRIX_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "enmach/Arena.hpp"
+#include "enmach/CompiledKey.hpp"
+#include "enmach/PackedState.hpp"
+#include "enmach/common.hpp"
+#include "enmach/input.hpp"
+#include "enmach/stepping.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  // One ciphertext deciphered from every start position of the three stepping rotors (26^3 of them) for a fixed rotor
+  // order, reflector, ring setting and Zusatzwalze, without plugs, so that any number of scoring functions can read the
+  // candidates instead of running the machine again. Position p is the rotor offsets left * 676 + middle * 26 + right,
+  // the effective offsets of a Cursor.
+  //
+  // Everything lives in an Arena: the scrambler permutation of every rotor state (26 lanes padded to 32), the state
+  // each key press leads to (enmach::step, the rules of EnigmaMachine::increment including the double step) and the
+  // deciphered rows, each a whole number of cache line tiles so that rows are aligned and a scoring function can read
+  // full tiles. A built matrix is never modified and can be shared between threads.
+  class DecryptionMatrix
+  {
+  public:
+    static constexpr std::size_t positions = 26U * 26U * 26U;
+    // letters per tile
+    static constexpr std::size_t tile = Arena::alignment;
+
+    using Lanes = std::array<std::uint8_t, 32>;
+
+    // Letters per row, length rounded up to whole tiles
+    [[nodiscard]] static constexpr auto stride(std::size_t length) noexcept -> std::size_t { return (length + tile - 1U) / tile * tile; }
+
+    // Arena capacity a matrix of a message of length letters takes, about 26^3 * (length + 34) bytes
+    [[nodiscard]] static constexpr auto bytes(std::size_t length) noexcept -> std::size_t
+    {
+      return Arena::bytes<Lanes>(positions) + Arena::bytes<std::uint16_t>(positions) + Arena::bytes<std::uint8_t>(positions * stride(length));
+    }
+
+    // Rotor order, reflector, ring setting and Zusatzwalze offset come from key, its initial position and plugs are
+    // ignored. ciphertext holds letters only (std::invalid_argument otherwise), std::bad_alloc is thrown when arena has
+    // less than bytes(ciphertext.size()) left.
+    DecryptionMatrix(Arena &arena, const CompiledKey &key, std::string_view ciphertext)
+        : length_{ciphertext.size()}, stride_{stride(ciphertext.size())}, notches_{key.notches_}, zusatzwalze_{zusatzwalze(key.origin)}
+    {
+      if (input::count_letters(ciphertext.data(), ciphertext.data() + ciphertext.size()) != ciphertext.size())
+        throw std::invalid_argument("Ciphertext must hold letters only");
+      this->scramblers = arena.allocate<Lanes>(positions);
+      this->successors = arena.allocate<std::uint16_t>(positions);
+      this->rows       = arena.allocate<std::uint8_t>(positions * this->stride_);
+
+      // the core of the left and middle rotor (and Zusatzwalze) once per pair, the right rotor around it
+      const std::size_t  right = key.rotor_count - 1U;
+      CompiledKey::State state{};
+      state.zusatzwalze = this->zusatzwalze_;
+      for (std::uint8_t left{}; left < ETW.size(); ++left)
+        for (std::uint8_t middle{}; middle < ETW.size(); ++middle)
+        {
+          state.odometer = {left, middle, 0U};
+          key.rebuild_core(state);
+          for (std::uint8_t offset{}; offset < ETW.size(); ++offset)
+          {
+            Lanes &lanes = this->scramblers[index_of({left, middle, offset})];
+            lanes.fill(0U);
+            for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+              lanes[letter] = (*key.inverse[right])[offset][state.core[(*key.forward[right])[offset][letter]]];
+          }
+        }
+      for (std::size_t position{}; position < positions; ++position)
+      {
+        Odometer odometer = odometer_of(position);
+        step(odometer, this->notches_);
+        this->successors[position] = static_cast<std::uint16_t>(index_of(odometer));
+      }
+
+      // every key press steps before the letter goes through
+      std::vector<std::uint8_t> cipher(this->length_);
+      for (std::size_t offset{}; offset < this->length_; ++offset)
+        cipher[offset] = static_cast<std::uint8_t>(to_lowercase(ciphertext[offset]) - 'a');
+      for (std::size_t position{}; position < positions; ++position)
+      {
+        std::uint8_t *row     = this->rows + position * this->stride_;
+        std::size_t   current = position;
+        for (std::size_t offset{}; offset < this->length_; ++offset)
+        {
+          current     = this->successors[current];
+          row[offset] = this->scramblers[current][cipher[offset]];
+        }
+        std::memset(row + this->length_, 0, this->stride_ - this->length_);
+      }
+    }
+
+    [[nodiscard]] auto length() const noexcept -> std::size_t { return this->length_; }
+
+    // Position of the stepping rotors of cursor
+    [[nodiscard]] static auto position(Cursor cursor) noexcept -> std::size_t { return index_of(unpack(cursor.state)); }
+
+    // A cursor at position for the key the matrix was built from. Throws std::out_of_range.
+    [[nodiscard]] auto cursor(std::size_t position) const -> Cursor
+    {
+      if (position >= positions)
+        throw std::out_of_range("Position out of range");
+      return {pack(odometer_of(position), this->zusatzwalze_)};
+    }
+
+    // The message deciphered from position (letter indices 0-25) followed by zeros up to stride(length()), tile aligned.
+    // Throws std::out_of_range.
+    [[nodiscard]] auto row(std::size_t position) const -> const std::uint8_t *
+    {
+      if (position >= positions)
+        throw std::out_of_range("Position out of range");
+      return this->rows + position * this->stride_;
+    }
+
+    // Scrambler (everything but the plugboard) at letter offset of the message started from position, indexed by the
+    // letter coming from the plugboard. Throws std::out_of_range.
+    [[nodiscard]] auto scrambler(std::size_t position, std::size_t offset) const -> const Lanes &
+    {
+      if (position >= positions || offset >= this->length_)
+        throw std::out_of_range("Position or offset out of range");
+      Odometer odometer = odometer_of(position);
+      advance(odometer, this->notches_, offset + 1U);
+      return this->scramblers[index_of(odometer)];
+    }
+
+  private:
+    [[nodiscard]] static constexpr auto index_of(const Odometer &odometer) noexcept -> std::size_t { return (static_cast<std::size_t>(odometer.left) * ETW.size() + odometer.middle) * ETW.size() + odometer.right; }
+
+    [[nodiscard]] static constexpr auto odometer_of(std::size_t position) noexcept -> Odometer
+    {
+      return {static_cast<std::uint8_t>(position / (ETW.size() * ETW.size())), static_cast<std::uint8_t>(position / ETW.size() % ETW.size()), static_cast<std::uint8_t>(position % ETW.size())};
+    }
+
+    std::size_t    length_;
+    std::size_t    stride_;
+    Notches        notches_;
+    std::uint8_t   zusatzwalze_;
+    Lanes         *scramblers{};
+    std::uint16_t *successors{};
+    std::uint8_t  *rows{};
+  };
+} // namespace enmach
+
+#endif // ENMACH_DECRYPTIONMATRIX_HPP_
@@ -0,0 +1,125 @@
+#ifndef ENMACH_DYNAMICENIGMA_HPP_
+#define ENMACH_DYNAMICENIGMA_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "enmach/CompiledKey.hpp"
+#include "enmach/PackedState.hpp"
+#include "enmach/StepSequence.hpp"
+#include "enmach/input.hpp"
+#include "enmach/simd.hpp"
+#include "enmach/stepping.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  // Same machine as EnigmaM1/EnigmaM3/EnigmaM4 with the model, rotors, reflector and plugboard chosen at runtime.
+  // It runs on the same pre-shifted wiring tables, core cache, stepping and SIMD kernels as the template machine.
+  // The tables live in a CompiledKey shared by every copy, a copy only duplicates the rotor state.
+  class DynamicEnigma
+  {
+  public:
+    // Same arguments as CompiledKey
+    DynamicEnigma(Model model, ReflectorId reflector, const std::vector<RotorId> &rotors, std::string_view ringstellung, std::string_view grundstellung, std::string_view plugs = {})
+        : DynamicEnigma(std::make_shared<const CompiledKey>(model, reflector, rotors, ringstellung, grundstellung, plugs))
+    {
+    }
+
+    // At the initial position of key
+    explicit DynamicEnigma(std::shared_ptr<const CompiledKey> key) : key_{std::move(key)}
+    {
+      if (this->key_ == nullptr)
+        throw std::invalid_argument("DynamicEnigma needs a key");
+      this->origin = this->key_->cursor().state;
+      this->state  = this->key_->state(this->origin);
+    }
+
+    [[nodiscard]] auto model() const noexcept -> Model { return this->key_->model(); }
+
+    [[nodiscard]] auto key() const noexcept -> const std::shared_ptr<const CompiledKey> & { return this->key_; }
+
+    [[nodiscard]] auto cursor() const noexcept -> Cursor { return {this->snapshot()}; }
+
+    auto increment() noexcept -> void
+    {
+      NotchStepper stepper{this->state.odometer, this->key_->notches()};
+      this->key_->apply(this->state, stepper.next());
+      ++this->position_;
+    }
+
+    [[nodiscard]] auto exec(char letter) const -> char { return static_cast<char>('a' + this->key_->substitute(this->state, detail::letter_index(letter))); }
+
+    // Same contract as EnigmaMachine::transform, the Input policy is chosen per call
+    template<class Input = input::Strict>
+    auto transform(const char *first, const char *last, char *output, simd::Isa isa = simd::Isa::AVX2) -> char *
+    {
+      NotchStepper stepper{this->state.odometer, this->key_->notches()};
+      return input::transform<Input>(first, last, output, [this, isa, &stepper](const char *begin, const char *end, char *out) { this->transform_letters(begin, end, out, isa, stepper); });
+    }
+
+    template<class Input = input::Strict>
+    auto transform(std::string_view input, char *output, simd::Isa isa = simd::Isa::AVX2) -> char * { return this->transform<Input>(input.data(), input.data() + input.size(), output, isa); }
+
+    [[nodiscard]] auto stepSequence() const -> StepSequence { return StepSequence(unpack(this->origin), this->key_->notches()); }
+
+    template<class Input = input::Strict>
+    auto transform(const char *first, const char *last, char *output, const StepSequence &sequence, simd::Isa isa = simd::Isa::AVX2) -> char *
+    {
+      if (sequence.start() != unpack(this->origin) || sequence.notches() != this->key_->notches())
+        throw std::invalid_argument("Step sequence does not belong to the current rotor settings");
+      SequenceStepper stepper{sequence, sequence.index(this->position_)};
+      return input::transform<Input>(first, last, output, [this, isa, &stepper](const char *begin, const char *end, char *out) { this->transform_letters(begin, end, out, isa, stepper); });
+    }
+
+    template<class Input = input::Strict>
+    auto transform(std::string_view input, char *output, const StepSequence &sequence, simd::Isa isa = simd::Isa::AVX2) -> char * { return this->transform<Input>(input.data(), input.data() + input.size(), output, sequence, isa); }
+
+    auto advance(std::uint64_t count) noexcept -> void
+    {
+      enmach::advance(this->state.odometer, this->key_->notches(), count);
+      this->key_->rebuild_core(this->state);
+      this->position_ += count;
+    }
+
+    auto rewind(std::uint64_t count) -> void
+    {
+      if (count > this->position_)
+        throw std::out_of_range("Cannot rewind past the initial rotor position");
+      this->state.odometer = unpack(this->origin);
+      enmach::advance(this->state.odometer, this->key_->notches(), this->position_ - count);
+      this->key_->rebuild_core(this->state);
+      this->position_ -= count;
+    }
+
+    [[nodiscard]] auto position() const noexcept -> std::uint64_t { return this->position_; }
+
+    [[nodiscard]] auto snapshot() const noexcept -> PackedState { return pack(this->state.odometer, this->state.zusatzwalze); }
+
+    auto restore(PackedState state) -> void
+    {
+      this->origin    = this->key_->cursor(state).state;
+      this->state     = this->key_->state(this->origin);
+      this->position_ = 0U;
+    }
+
+  private:
+    template<class Stepper>
+    auto transform_letters(const char *first, const char *last, char *output, simd::Isa isa, Stepper &stepper) noexcept -> void
+    {
+      this->position_ += static_cast<std::uint64_t>(last - first);
+      this->key_->transform_letters(this->state, first, last, output, isa, stepper);
+    }
+
+    std::shared_ptr<const CompiledKey> key_;
+    CompiledKey::State                 state{};
+    PackedState                        origin{};
+    std::uint64_t                      position_{};
+  };
+} // namespace enmach
+
+#endif // ENMACH_DYNAMICENIGMA_HPP_
@@ -1,21 +1,46 @@
 #ifndef ENMACH_ENIGMAMACHINE_HPP_
 #define ENMACH_ENIGMAMACHINE_HPP_
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
 #include <string_view>
 #include <tuple>
 
+#include "enmach/PackedState.hpp"
 #include "enmach/Reflector.hpp"
 #include "enmach/Rotor.hpp"
+#include "enmach/Steckerbrett.hpp"
+#include "enmach/StepSequence.hpp"
+#include "enmach/input.hpp"
+#include "enmach/instrumentation.hpp"
+#include "enmach/simd.hpp"
+#include "enmach/stepping.hpp"
 #include "enmach/utils.hpp"
 
 namespace enmach
 {
-  template<class AllowedRotors, class AllowedReflectors, std::size_t RequiredRotors>
+  template<class AllowedRotors, class AllowedReflectors, std::size_t RequiredRotors, class RotorEngine = rotor_engine::Table, class InputPolicy = input::Strict, class InstrumentationPolicy = instrumentation::None>
   struct EnigmaMachineConfiguration
   {
+    static_assert(input::is_policy<InputPolicy>, "[ERROR] Input policy must be one of the enmach::input policies.");
+    static_assert(instrumentation::is_policy<InstrumentationPolicy>, "[ERROR] Instrumentation policy must declare constexpr static bool enabled.");
     using Rotors                   = AllowedRotors;
     using Reflectors               = AllowedReflectors;
     constexpr static std::size_t N = RequiredRotors;
+    using Engine                   = RotorEngine;
+    using Input                    = InputPolicy;
+    using Instrumentation          = InstrumentationPolicy;
+
+    template<class OtherEngine>
+    using with_engine = EnigmaMachineConfiguration<AllowedRotors, AllowedReflectors, RequiredRotors, OtherEngine, InputPolicy, InstrumentationPolicy>;
+
+    template<class OtherInput>
+    using with_input = EnigmaMachineConfiguration<AllowedRotors, AllowedReflectors, RequiredRotors, RotorEngine, OtherInput, InstrumentationPolicy>;
+
+    template<class OtherInstrumentation>
+    using with_instrumentation = EnigmaMachineConfiguration<AllowedRotors, AllowedReflectors, RequiredRotors, RotorEngine, InputPolicy, OtherInstrumentation>;
   };
 
   template<class Config, class Plugboard, class ReflectorTag, class... RotorTags>
@@ -27,13 +52,72 @@ namespace enmach
     static_assert((Config::Rotors::template is_in_set<RotorTags>() && ...), "[ERROR] All rotors must belong to the allowed set for this machine.");
     static_assert((Config::Reflectors::template is_in_set<ReflectorTag>()), "[ERROR] Reflector must belong to the allowed set for this machine.");
 
-    auto increment() noexcept -> void { increment_rotors(this->rotors); }
+    using Configuration = Config;
+
+    template<class OtherConfig>
+    using rebind = EnigmaMachine<OtherConfig, Plugboard, ReflectorTag, RotorTags...>;
+
+    constexpr EnigmaMachine() : EnigmaMachine(Plugboard{}) {}
+
+    constexpr explicit EnigmaMachine(const Plugboard &plugboard) : plugboard{make_plug_table(plugboard)} { this->rebuild_core(); }
+
+    constexpr auto setPlugboard(const Plugboard &plugboard) -> void { this->plugboard = make_plug_table(plugboard); }
+
+    auto increment() noexcept -> void { this->step(); }
+
+    // Moves the rotors as count key presses would, in constant time
+    auto advance(std::uint64_t count) noexcept -> void
+    {
+      Odometer odometer = this->odometer();
+      enmach::advance(odometer, this->notches(), count);
+      this->setOdometer(odometer);
+      this->position_ += count;
+    }
+
+    // Moves the rotors back to where they were count key presses ago, at most back to the last
+    // setGrundstellung/setRingstellung call since the stepping cannot be unambiguously undone past it
+    auto rewind(std::uint64_t count) -> void
+    {
+      if (count > this->position_)
+        throw std::out_of_range("Cannot rewind past the initial rotor position");
+      Odometer odometer = this->origin;
+      enmach::advance(odometer, this->notches(), this->position_ - count);
+      this->setOdometer(odometer);
+      this->position_ -= count;
+    }
+
+    // Offsets of all rotors, restore() brings any machine with the same rotors and ring settings back to them
+    [[nodiscard]] constexpr auto snapshot() const noexcept -> PackedState
+    {
+      if constexpr (Config::N == 4)
+        return pack(this->odometer(), std::get<0>(this->rotors).effectiveOffset());
+      else
+        return pack(this->odometer());
+    }
+
+    // Makes state the new initial rotor position: position() restarts at 0 and rewind() stops there
+    constexpr auto restore(PackedState state) -> void
+    {
+      if (!is_valid(state) || (Config::N == 3 && zusatzwalze(state) != 0U))
+        throw std::invalid_argument("Packed state does not hold an offset for each rotor");
+      if constexpr (Config::N == 4)
+        std::get<0>(this->rotors).setEffectiveOffset(zusatzwalze(state));
+      const Odometer odometer = unpack(state);
+      std::get<Config::N - 3>(this->rotors).setEffectiveOffset(odometer.left);
+      std::get<Config::N - 2>(this->rotors).setEffectiveOffset(odometer.middle);
+      std::get<Config::N - 1>(this->rotors).setEffectiveOffset(odometer.right);
+      this->reset_origin();
+    }
+
+    // Key presses since the last setGrundstellung/setRingstellung call
+    [[nodiscard]] constexpr auto position() const noexcept -> std::uint64_t { return this->position_; }
 
     template<class... Args>
     constexpr auto setRingstellung(Args &&...args) -> void
     {
       static_assert(Config::N == (sizeof...(Args)), "[ERROR] Input arguments do not match the number of specified rotors");
       assign_ringstellung(this->rotors, std::make_tuple(args...));
+      this->reset_origin();
     }
 
     template<class... Args>
@@ -41,40 +125,229 @@ namespace enmach
     {
       static_assert(Config::N == (sizeof...(Args)), "[ERROR] Input arguments do not match the number of specified rotors");
       assign_grundstellung(this->rotors, std::make_tuple(args...));
+      this->reset_origin();
     }
 
-    [[nodiscard]] constexpr auto exec(char letter) -> char
+    [[nodiscard]] constexpr auto exec(char letter) -> char { return static_cast<char>('a' + this->substitute(static_cast<std::uint8_t>(to_lowercase_or_die(letter) - 'a'))); }
+
+    // Steps and substitutes every letter of [first, last) into output, which must hold at least (last - first) characters.
+    // Anything else is handled as the Input policy prescribes (by default the input is validated once before any rotor
+    // moves), output may alias first for in-place operation. Returns the end of the output.
+    // Whole blocks of letters go through the widest SIMD kernel the CPU supports, capped at isa.
+    template<class Input = typename Config::Input>
+    auto transform(const char *first, const char *last, char *output, simd::Isa isa = simd::Isa::AVX2) -> char *
     {
-      letter = to_lowercase_or_die(letter);
+      NotchStepper stepper{this->odometer(), this->notches()};
+      return this->transform_input<Input>(first, last, output, isa, stepper);
+    }
 
-      letter             = this->plugboard(letter);
-      std::uint8_t index = static_cast<std::uint8_t>(letter - 'a');
+    template<class Input = typename Config::Input>
+    auto transform(std::string_view input, char *output, simd::Isa isa = simd::Isa::AVX2) -> char * { return this->transform<Input>(input.data(), input.data() + input.size(), output, isa); }
 
-      index = this->forward_transformation(this->rotors, index);
-      index = reflector.reflect(index);
-      index = this->inverse_transformation(this->rotors, index);
+    // Rotor states from the last setGrundstellung/setRingstellung call on, to be shared by every transform under this key
+    [[nodiscard]] auto stepSequence() const -> StepSequence { return StepSequence(this->origin, this->notches()); }
 
-      letter = static_cast<char>(index + 'a');
-      letter = this->plugboard(letter);
-      return letter;
+    // Same as above, reading the rotor states from sequence instead of evaluating the notches on every key press
+    template<class Input = typename Config::Input>
+    auto transform(const char *first, const char *last, char *output, const StepSequence &sequence, simd::Isa isa = simd::Isa::AVX2) -> char *
+    {
+      if (sequence.start() != this->origin || sequence.notches() != this->notches())
+        throw std::invalid_argument("Step sequence does not belong to the current rotor settings");
+      SequenceStepper stepper{sequence, sequence.index(this->position_)};
+      return this->transform_input<Input>(first, last, output, isa, stepper);
     }
 
+    template<class Input = typename Config::Input>
+    auto transform(std::string_view input, char *output, const StepSequence &sequence, simd::Isa isa = simd::Isa::AVX2) -> char * { return this->transform<Input>(input.data(), input.data() + input.size(), output, sequence, isa); }
+
   private:
-    std::tuple<Rotor<RotorTags>...> rotors;
-    Reflector<ReflectorTag>         reflector{};
-    Plugboard                       plugboard{};
+    using Instrumentation = typename Config::Instrumentation;
+
+    // Rotor movements of the key presses of a transform call, handed to the instrumentation policy at once
+    struct StepCounter
+    {
+      Odometer               previous;
+      Notches                notches;
+      instrumentation::Steps steps{};
+
+      constexpr auto record([[maybe_unused]] const StepSequence::State &state) noexcept -> void
+      {
+        if constexpr (Instrumentation::enabled)
+        {
+          const Odometer next{state.left, state.middle, state.right};
+          this->steps.record(this->previous, next, at_notch(this->notches.right, this->previous.right));
+          this->previous = next;
+        }
+      }
+
+      auto flush() noexcept -> void
+      {
+        if constexpr (Instrumentation::enabled)
+          Instrumentation::steps(this->steps);
+      }
+    };
+
+    std::tuple<Rotor<RotorTags, typename Config::Engine>...> rotors;
+    Reflector<ReflectorTag>                                  reflector{};
+    enmach::Steckerbrett::Table                              plugboard{};
+    // Rotors left of the rightmost one and the reflector, composed into one permutation
+    std::array<std::uint8_t, 26> core{};
+    Odometer                     origin{};
+    std::uint64_t                position_{};
+
+    constexpr auto step() noexcept -> void
+    {
+      if constexpr (Instrumentation::enabled)
+      {
+        const Odometer         before     = this->odometer();
+        const bool             right_turn = std::get<Config::N - 1>(this->rotors).atNotch();
+        instrumentation::Steps steps;
+        this->move_rotors();
+        steps.record(before, this->odometer(), right_turn);
+        Instrumentation::steps(steps);
+      }
+      else
+        this->move_rotors();
+    }
+
+    constexpr auto move_rotors() noexcept -> void
+    {
+      ++this->position_;
+      if (increment_rotors(this->rotors))
+        this->rebuild_core();
+    }
+
+    constexpr auto reset_origin() noexcept -> void
+    {
+      this->origin    = this->odometer();
+      this->position_ = 0U;
+      this->rebuild_core();
+    }
+
+    [[nodiscard]] constexpr auto notches() const noexcept -> Notches { return {std::get<Config::N - 2>(this->rotors).notches(), std::get<Config::N - 1>(this->rotors).notches()}; }
+
+    [[nodiscard]] constexpr auto odometer() const noexcept -> Odometer
+    {
+      return {std::get<Config::N - 3>(this->rotors).effectiveOffset(), std::get<Config::N - 2>(this->rotors).effectiveOffset(), std::get<Config::N - 1>(this->rotors).effectiveOffset()};
+    }
+
+    // The Zusatzwalze, if any, never steps and is left untouched
+    constexpr auto setOdometer(const Odometer &odometer) noexcept -> void
+    {
+      std::get<Config::N - 3>(this->rotors).setEffectiveOffset(odometer.left);
+      std::get<Config::N - 2>(this->rotors).setEffectiveOffset(odometer.middle);
+      std::get<Config::N - 1>(this->rotors).setEffectiveOffset(odometer.right);
+      this->rebuild_core();
+    }
+
+    constexpr auto rebuild_core() noexcept -> void
+    {
+      for (std::uint8_t index{}; index < this->core.size(); ++index)
+      {
+        std::uint8_t value = this->forward_transformation(this->rotors, index);
+        value              = this->reflector.reflect(value);
+        this->core[index]  = this->inverse_transformation(this->rotors, value);
+      }
+    }
+
+    template<class Input, class Stepper>
+    auto transform_input(const char *first, const char *last, char *output, simd::Isa isa, Stepper &stepper) -> char *
+    {
+      const auto letters = [this, isa, &stepper](const char *begin, const char *end, char *out) { this->transform_letters(begin, end, out, isa, stepper); };
+      if constexpr (Instrumentation::enabled)
+      {
+        const auto start = instrumentation::now();
+        char      *end   = input::transform<Input>(first, last, output, letters);
+        Instrumentation::bulk(static_cast<std::uint64_t>(last - first), instrumentation::nanoseconds_since(start));
+        return end;
+      }
+      else
+        return input::transform<Input>(first, last, output, letters);
+    }
+
+    // [first, last) holds letters only, or whatever the caller accepts an unspecified letter for
+    template<class Stepper>
+    auto transform_letters(const char *first, const char *last, char *output, simd::Isa isa, Stepper &stepper) noexcept -> void
+    {
+      this->position_ += static_cast<std::uint64_t>(last - first);
+      StepCounter counter{this->odometer(), this->notches()};
+
+      isa = std::min(isa, simd::detected());
+      if (isa != simd::Isa::Scalar)
+        this->transform_blocks(first, last, output, isa, stepper, counter);
+
+      // the right rotor steps in place, the core only changes when another rotor moves
+      auto &right = std::get<Config::N - 1>(this->rotors);
+      for (; first != last; ++first, ++output)
+      {
+        const StepSequence::State &state = stepper.next();
+        counter.record(state);
+        if (state.moved)
+          this->setOdometer({state.left, state.middle, state.right});
+        else
+          right.step();
+        *output = static_cast<char>('a' + this->substitute(to_index(*first)));
+      }
+      counter.flush();
+    }
+
+    // Transforms as many whole blocks of simd::lanes(isa) letters as fit, leaving first and output past them
+    template<class Stepper>
+    auto transform_blocks(const char *&first, const char *last, char *&output, simd::Isa isa, Stepper &stepper, StepCounter &counter) -> void
+    {
+      const auto lanes = simd::lanes(isa);
+      if (static_cast<std::size_t>(last - first) < lanes)
+        return;
+
+      simd::Tables tables{};
+      std::copy(this->plugboard.begin(), this->plugboard.end(), tables.plugboard);
+      for (std::uint8_t index{}; index < ETW.size(); ++index)
+        tables.reflector[index] = this->reflector.reflect(index);
+      tables.rotors = Config::N;
+      std::size_t rotor{};
+      ((std::copy(RotorTags::fvalue.begin(), RotorTags::fvalue.end(), tables.forward[rotor]), std::copy(RotorTags::rvalue.begin(), RotorTags::rvalue.end(), tables.inverse[rotor]), ++rotor), ...);
+
+      // the Zusatzwalze, if any, keeps its offset
+      simd::Offsets offsets{};
+      if constexpr (Config::N == 4)
+        std::fill_n(offsets.value[0], lanes, std::get<0>(this->rotors).effectiveOffset());
+
+      for (; static_cast<std::size_t>(last - first) >= lanes; first += lanes, output += lanes)
+      {
+        for (std::size_t lane{}; lane < lanes; ++lane)
+        {
+          const StepSequence::State &state = stepper.next();
+          counter.record(state);
+          offsets.value[Config::N - 3][lane] = state.left;
+          offsets.value[Config::N - 2][lane] = state.middle;
+          offsets.value[Config::N - 1][lane] = state.right;
+        }
+        simd::substitute(isa, tables, offsets, first, output);
+      }
+      this->setOdometer({offsets.value[Config::N - 3][lanes - 1U], offsets.value[Config::N - 2][lanes - 1U], offsets.value[Config::N - 1][lanes - 1U]});
+    }
+
+    [[nodiscard]] constexpr auto substitute(std::uint8_t index) const noexcept -> std::uint8_t
+    {
+      index = this->plugboard[index];
+      index = std::get<Config::N - 1>(this->rotors).forward(index);
+      index = this->core[index];
+      index = std::get<Config::N - 1>(this->rotors).inverse(index);
+      return this->plugboard[index];
+    }
 
     template<class Tuple, std::size_t... Is>
     constexpr static auto forward_transformation_impl(Tuple &&t, std::uint8_t index, std::index_sequence<Is...>) noexcept -> std::uint8_t
     {
-      ((index = std::get<Config::N - 1 - Is>(t).forward(index)), ...);
+      ((index = std::get<sizeof...(Is) - 1 - Is>(t).forward(index)), ...);
       return index;
     }
 
+    // Right to left through every rotor but the rightmost one
     template<class Tuple>
     constexpr static auto forward_transformation(Tuple &&t, std::uint8_t index) noexcept -> std::uint8_t
     {
-      return forward_transformation_impl(std::forward<Tuple>(t), index, std::make_index_sequence<Config::N>{});
+      return forward_transformation_impl(std::forward<Tuple>(t), index, std::make_index_sequence<Config::N - 1>{});
     }
 
     template<class Tuple, std::size_t... Is>
@@ -84,24 +357,28 @@ namespace enmach
       return index;
     }
 
+    // Left to right through every rotor but the rightmost one
     template<class Tuple>
     constexpr static auto inverse_transformation(Tuple &&t, std::uint8_t index) noexcept -> std::uint8_t
     {
-      return inverse_transformation_impl(std::forward<Tuple>(t), index, std::make_index_sequence<Config::N>{});
+      return inverse_transformation_impl(std::forward<Tuple>(t), index, std::make_index_sequence<Config::N - 1>{});
     }
 
+    // Returns true when a rotor other than the rightmost one moved, i.e. when the right or the middle rotor sat on a notch
     template<class Tuple, std::size_t... Is>
-    constexpr static auto increment_rotors_impl(Tuple &&t, std::index_sequence<Is...>) noexcept -> void
+    constexpr static auto increment_rotors_impl(Tuple &&t, std::index_sequence<Is...>) noexcept -> bool
     {
       auto           flag{true};
+      auto           moved{false};
       constexpr bool has_zusatzwalze = (Set<rotor_tags::BETA, rotor_tags::GAMMA>::template is_in_set<RotorTags>() || ...);
-      ((flag = std::get<Config::N - 1 - Is>(t).increment(flag, Is < Config::N - static_cast<std::size_t>(has_zusatzwalze) - 1)), ...);
+      ((flag = std::get<Config::N - 1 - Is>(t).increment(flag, Is < Config::N - static_cast<std::size_t>(has_zusatzwalze) - 1), moved = moved || (Is < 2 && flag)), ...);
+      return moved;
     }
 
     template<class Tuple>
-    constexpr static auto increment_rotors(Tuple &&t) noexcept -> void
+    constexpr static auto increment_rotors(Tuple &&t) noexcept -> bool
     {
-      increment_rotors_impl(std::forward<Tuple>(t), std::make_index_sequence<Config::N>{});
+      return increment_rotors_impl(std::forward<Tuple>(t), std::make_index_sequence<Config::N>{});
     }
 
     template<class Tuple1, class Tuple2, std::size_t... Is>
@@ -128,6 +405,15 @@ namespace enmach
       assign_ringstellung_impl(std::forward<Tuple1>(t1), std::forward<Tuple2>(t2), std::make_index_sequence<Config::N>{});
     }
   };
+
+  template<class Machine, class Engine>
+  using with_engine_t = typename Machine::template rebind<typename Machine::Configuration::template with_engine<Engine>>;
+
+  template<class Machine, class Input>
+  using with_input_t = typename Machine::template rebind<typename Machine::Configuration::template with_input<Input>>;
+
+  template<class Machine, class Instrumentation>
+  using with_instrumentation_t = typename Machine::template rebind<typename Machine::Configuration::template with_instrumentation<Instrumentation>>;
 } // namespace enmach
 
 #endif // ENMACH_ENIGMAMACHINE_HPP_
\ No newline at end of file
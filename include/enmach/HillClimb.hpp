@@ -0,0 +1,333 @@
+#ifndef ENMACH_HILLCLIMB_HPP_
+#define ENMACH_HILLCLIMB_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "enmach/Bombe.hpp"
+#include "enmach/CompiledKey.hpp"
+#include "enmach/Ngrams.hpp"
+#include "enmach/PackedState.hpp"
+#include "enmach/PlugboardSearch.hpp"
+#include "enmach/common.hpp"
+#include "enmach/input.hpp"
+#include "enmach/parallel.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  // Ciphertext-only attack after Gillogly and Weierud-Sullivan. Every rotor order, rotor position and right ring
+  // setting is tried without plugs, the ones whose decryption has the highest index of coincidence are kept. For each
+  // of them the middle and right ring settings are searched the same way, then the plugboard is built up by
+  // hill-climbing on bigram and then trigram log-probabilities (PlugboardSearch). The search decrypts through a table
+  // of every rotor offset per rotor order and ring trials through CompiledKey.
+  class HillClimb
+  {
+  public:
+    struct Result
+    {
+      // left to right, Zusatzwalze first on the M4
+      std::vector<RotorId> rotors;
+      ReflectorId          reflector;
+      std::string          rings;
+      std::string          positions;
+      std::string          plugs;
+      // trigram log-probability per letter of the plaintext
+      double               score;
+      std::string          plaintext;
+    };
+
+    // ciphertext holds letters only, bigrams and trigrams are trained on the language of the plaintext. Throws
+    // std::invalid_argument otherwise.
+    HillClimb(std::string_view ciphertext, Ngrams bigrams, Ngrams trigrams) : bigrams_{std::move(bigrams)}, trigrams_{std::move(trigrams)}
+    {
+      if (this->bigrams_.n() != 2U || this->trigrams_.n() != 3U)
+        throw std::invalid_argument("Expected bigram and trigram statistics");
+      if (ciphertext.size() < 3U || input::count_letters(ciphertext.data(), ciphertext.data() + ciphertext.size()) != ciphertext.size())
+        throw std::invalid_argument("Ciphertext must hold at least 3 letters and nothing else");
+      for (const char letter : ciphertext)
+        this->ciphertext_.push_back(static_cast<char>(to_lowercase(letter)));
+    }
+
+    [[nodiscard]] auto run(Model model, ReflectorId reflector, std::size_t threads = std::thread::hardware_concurrency(), std::size_t candidates = 32U) const -> std::vector<Result>
+    {
+      return this->run(model, reflector, Bombe::orders(model), threads, candidates);
+    }
+
+    // The keys found from the best candidates positions, best first. Orders and reflector are checked as by
+    // DynamicEnigma (std::invalid_argument), rotor orders and then candidates are spread across threads.
+    [[nodiscard]] auto run(Model model, ReflectorId reflector, const std::vector<std::vector<RotorId>> &orders, std::size_t threads = std::thread::hardware_concurrency(), std::size_t candidates = 32U) const -> std::vector<Result>
+    {
+      for (const auto &order : orders)
+        detail::validate_key(model, reflector, order);
+      if (orders.empty() || candidates == 0U)
+        return {};
+      threads = std::max<std::size_t>(1U, threads);
+
+      // positions by index of coincidence, one work item per rotor order (and Zusatzwalze offset on the M4)
+      const std::size_t                   zusatzwalzen = model == Model::M4 ? ETW.size() : 1U;
+      std::vector<std::vector<Candidate>> found(threads);
+      {
+        detail::WorkRanges work(orders.size() * zusatzwalzen, threads);
+        detail::run_workers(threads, [this, reflector, candidates, zusatzwalzen, &orders, &work, &found](std::size_t worker) {
+          Best                      best(candidates);
+          std::vector<std::uint8_t> table;
+          while (const auto item = work.next(worker))
+            this->positions(*item / zusatzwalzen, orders[*item / zusatzwalzen], reflector, static_cast<std::uint8_t>(*item % zusatzwalzen), table, best);
+          found[worker] = best.take();
+        });
+      }
+      Best best(candidates);
+      for (const auto &candidates_of_worker : found)
+        for (const Candidate &candidate : candidates_of_worker)
+          best.push(candidate);
+      const std::vector<Candidate> kept = best.take();
+
+      // rings and plugboard of every candidate
+      std::vector<Result> results(kept.size());
+      {
+        detail::WorkRanges work(kept.size(), threads);
+        detail::run_workers(threads, [this, model, reflector, &orders, &kept, &work, &results](std::size_t worker) {
+          while (const auto item = work.next(worker))
+            results[*item] = this->refine(model, reflector, orders[kept[*item].order], kept[*item]);
+        });
+      }
+      std::sort(results.begin(), results.end(), [](const Result &lhs, const Result &rhs) { return std::tie(rhs.score, lhs.rotors, lhs.positions) < std::tie(lhs.score, rhs.rotors, rhs.positions); });
+      results.erase(std::unique(results.begin(), results.end(), [](const Result &lhs, const Result &rhs) { return lhs.rotors == rhs.rotors && lhs.rings == rhs.rings && lhs.positions == rhs.positions && lhs.plugs == rhs.plugs; }), results.end());
+      return results;
+    }
+
+  private:
+    struct Candidate
+    {
+      std::size_t                 order;
+      // at the message start, left to right
+      std::array<std::uint8_t, 4> offsets;
+      std::uint8_t                right_ring;
+      double                      score;
+    };
+
+    // The count highest scoring candidates seen so far
+    class Best
+    {
+    public:
+      explicit Best(std::size_t count) : count{count} {}
+
+      auto push(const Candidate &candidate) -> void
+      {
+        if (this->heap.size() == this->count && !(this->heap.top().score < candidate.score))
+          return;
+        this->heap.push(candidate);
+        if (this->heap.size() > this->count)
+          this->heap.pop();
+      }
+
+      [[nodiscard]] auto take() -> std::vector<Candidate>
+      {
+        std::vector<Candidate> candidates;
+        for (; !this->heap.empty(); this->heap.pop())
+          candidates.push_back(this->heap.top());
+        std::reverse(candidates.begin(), candidates.end());
+        return candidates;
+      }
+
+    private:
+      struct Lower
+      {
+        auto operator()(const Candidate &lhs, const Candidate &rhs) const noexcept -> bool { return lhs.score > rhs.score; }
+      };
+
+      std::size_t                                                   count;
+      std::priority_queue<Candidate, std::vector<Candidate>, Lower> heap;
+    };
+
+    auto decrypt(const CompiledKey &key, std::vector<std::uint8_t> &plaintext, std::string &buffer) const -> void
+    {
+      Cursor cursor = key.cursor();
+      key.transform<input::Unchecked>(cursor, this->ciphertext_, buffer.data());
+      for (std::size_t letter{}; letter < buffer.size(); ++letter)
+        plaintext[letter] = static_cast<std::uint8_t>(buffer[letter] - 'a');
+    }
+
+    // Plaintext letter of every cipher letter at every offset of the left, middle and right rotor without plugs,
+    // table[((left * 26 + middle) * 26 + right) * 26 + cipher], with the Zusatzwalze of the M4 at zusatzwalze
+    static auto fill_table(const std::vector<RotorId> &order, ReflectorId reflector, std::uint8_t zusatzwalze, std::vector<std::uint8_t> &table) -> void
+    {
+      const std::size_t left  = order.size() - 3U;
+      const auto       &value = *detail::reflector_wirings[static_cast<std::size_t>(reflector)].value;
+      std::array<const detail::RotorWiring *, 4> wirings{};
+      for (std::size_t rotor{}; rotor < order.size(); ++rotor)
+        wirings[rotor] = &detail::rotor_wirings[static_cast<std::size_t>(order[rotor])];
+
+      table.resize(26U * 26U * 26U * 26U);
+      std::array<std::uint8_t, 26> core{};
+      for (std::uint8_t l{}; l < ETW.size(); ++l)
+        for (std::uint8_t m{}; m < ETW.size(); ++m)
+        {
+          for (std::uint8_t index{}; index < ETW.size(); ++index)
+          {
+            std::uint8_t contact = (*wirings[left + 1U]->forward)[m][index];
+            contact              = (*wirings[left]->forward)[l][contact];
+            if (left == 1U)
+              contact = (*wirings[0]->forward)[zusatzwalze][contact];
+            contact = value[contact];
+            if (left == 1U)
+              contact = (*wirings[0]->inverse)[zusatzwalze][contact];
+            contact     = (*wirings[left]->inverse)[l][contact];
+            core[index] = (*wirings[left + 1U]->inverse)[m][contact];
+          }
+          std::uint8_t *block = table.data() + (l * 26U + m) * 26U * 26U;
+          for (std::uint8_t r{}; r < ETW.size(); ++r)
+            for (std::uint8_t cipher{}; cipher < ETW.size(); ++cipher)
+              *block++ = (*wirings[left + 2U]->inverse)[r][core[(*wirings[left + 2U]->forward)[r][cipher]]];
+        }
+    }
+
+    // Every rotor position and right ring setting of one rotor order without plugs. The ring of the right rotor decides
+    // when the middle rotor turns over, a wrong one garbles a share of every 26 letters. The left rotor is assumed to
+    // stand still, which holds for most messages and costs only the letters after its step otherwise.
+    auto positions(std::size_t order_index, const std::vector<RotorId> &order, ReflectorId reflector, std::uint8_t zusatzwalze, std::vector<std::uint8_t> &table, Best &best) const -> void
+    {
+      fill_table(order, reflector, zusatzwalze, table);
+      const std::size_t left   = order.size() - 3U;
+      std::vector<std::uint8_t> cipher(this->ciphertext_.size());
+      for (std::size_t letter{}; letter < cipher.size(); ++letter)
+        cipher[letter] = static_cast<std::uint8_t>(this->ciphertext_[letter] - 'a');
+
+      for (std::uint8_t ring{}; ring < ETW.size(); ++ring)
+      {
+        const std::uint32_t notches = detail::notches_of(order[left + 2U], ring);
+        for (std::uint8_t l{}; l < ETW.size(); ++l)
+          for (std::uint8_t m{}; m < ETW.size(); ++m)
+            for (std::uint8_t r{}; r < ETW.size(); ++r)
+            {
+              // the same stepping as enmach::step with the left rotor standing still
+              std::uint8_t                middle = m;
+              std::uint8_t                right  = r;
+              const std::uint8_t         *block  = table.data() + (l * 26U + middle) * 26U * 26U;
+              std::array<std::size_t, 26> counts{};
+              for (const std::uint8_t letter : cipher)
+              {
+                const bool turn = at_notch(notches, right);
+                right           = step_offset(right, true);
+                if (turn)
+                {
+                  middle = step_offset(middle, true);
+                  block  = table.data() + (l * 26U + middle) * 26U * 26U;
+                }
+                ++counts[block[right * 26U + letter]];
+              }
+              std::array<std::uint8_t, 4> offsets{};
+              offsets[0]         = zusatzwalze;
+              offsets[left]      = l;
+              offsets[left + 1U] = m;
+              offsets[left + 2U] = r;
+              best.push({order_index, offsets, ring, index_of_coincidence(counts, cipher.size())});
+            }
+      }
+    }
+
+    auto refine(Model model, ReflectorId reflector, const std::vector<RotorId> &order, const Candidate &candidate) const -> Result
+    {
+      const std::size_t         rotors = order.size();
+      std::string               buffer(this->ciphertext_.size(), '\0');
+      std::vector<std::uint8_t> plaintext(buffer.size());
+
+      // the right ring moves the turnovers of the middle rotor, the middle ring those of the left one; the rotor
+      // offsets stay, so every position letter is offset plus ring
+      const auto ring_of = [rotors](std::size_t rotor, std::uint8_t middle, std::uint8_t right) -> std::uint8_t {
+        return rotor == rotors - 1U ? right : rotor == rotors - 2U ? middle : 0U;
+      };
+      const auto key_for = [&](std::uint8_t middle, std::uint8_t right) {
+        std::string rings(rotors, '\0');
+        std::string positions(rotors, '\0');
+        for (std::size_t rotor{}; rotor < rotors; ++rotor)
+        {
+          const std::uint8_t ring = ring_of(rotor, middle, right);
+          rings[rotor]            = static_cast<char>('a' + ring);
+          positions[rotor]        = static_cast<char>('a' + (candidate.offsets[rotor] + ring) % ETW.size());
+        }
+        return CompiledKey(model, reflector, order, rings, positions);
+      };
+      // the right ring comes from the position search, the middle ring only moves the left rotor
+      double       best = -1.0;
+      std::uint8_t middle_ring{};
+      std::uint8_t right_ring = candidate.right_ring;
+      for (std::uint8_t middle{}; middle < ETW.size(); ++middle)
+      {
+        this->decrypt(key_for(middle, right_ring), plaintext, buffer);
+        const double score = index_of_coincidence(plaintext.data(), plaintext.size());
+        if (score > best)
+        {
+          best        = score;
+          middle_ring = middle;
+        }
+      }
+
+      PlugboardSearch search(key_for(middle_ring, right_ring), this->ciphertext_);
+      search.climb(this->bigrams_);
+      double score = search.climb(this->trigrams_);
+
+      // with most of the plugboard known trigrams pin the right ring down better than the index of coincidence
+      const std::uint8_t climbed = right_ring;
+      for (std::uint8_t right{}; right < ETW.size(); ++right)
+      {
+        if (right == climbed)
+          continue;
+        PlugboardSearch trial(key_for(middle_ring, right), this->ciphertext_);
+        trial.setPlugs(search.plugs());
+        const double trial_score = trial.score(this->trigrams_);
+        if (trial_score > score)
+        {
+          score      = trial_score;
+          right_ring = right;
+        }
+      }
+      if (right_ring != climbed)
+      {
+        const Steckerbrett::Table plugs = search.plugs();
+        search                       = PlugboardSearch(key_for(middle_ring, right_ring), this->ciphertext_);
+        search.setPlugs(plugs);
+        score = search.climb(this->trigrams_);
+      }
+
+      Result result{order, reflector, {}, {}, {}, score / static_cast<double>(this->ciphertext_.size() - 2U), {}};
+      for (std::size_t rotor{}; rotor < rotors; ++rotor)
+      {
+        const std::uint8_t ring = ring_of(rotor, middle_ring, right_ring);
+        result.rings += static_cast<char>('A' + ring);
+        result.positions += static_cast<char>('A' + (candidate.offsets[rotor] + ring) % ETW.size());
+      }
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+      {
+        const std::uint8_t partner = search.plugs()[letter];
+        if (partner <= letter)
+          continue;
+        if (!result.plugs.empty())
+          result.plugs += ' ';
+        result.plugs += static_cast<char>('A' + letter);
+        result.plugs += static_cast<char>('A' + partner);
+      }
+      for (const std::uint8_t letter : search.plaintext())
+        result.plaintext += static_cast<char>('a' + letter);
+      return result;
+    }
+
+    std::string ciphertext_;
+    Ngrams      bigrams_;
+    Ngrams      trigrams_;
+  };
+} // namespace enmach
+
+#endif // ENMACH_HILLCLIMB_HPP_
@@ -0,0 +1,223 @@
+#ifndef ENMACH_KEYSPACE_HPP_
+#define ENMACH_KEYSPACE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "enmach/Bombe.hpp"
+#include "enmach/CompiledKey.hpp"
+#include "enmach/common.hpp"
+
+namespace enmach
+{
+  // Ring settings and initial positions of one rotor order, counted up to equivalence over a message of a given length.
+  // The wiring only sees the effective offset (initial position minus ring setting, see Rotor::setInternalDifference),
+  // the ring only moves the turnover notches. Two settings with the same effective offsets are therefore equivalent
+  // when every notch the machine looks at while typing the message answers the same: the left ring and the
+  // Zusatzwalze ring are never looked at, the right rotor is looked at on the offsets it passes, the middle rotor on
+  // the offsets the message takes it to. The canonical setting of a class is the one with the smallest rings.
+  class Keyspace
+  {
+  public:
+    struct Setting
+    {
+      std::string rings;
+      std::string positions;
+    };
+
+    // rotors are ordered left to right (Zusatzwalze first on the M4). Throws std::invalid_argument on rotors the model
+    // does not allow.
+    Keyspace(Model model, const std::vector<RotorId> &rotors, std::size_t length) : length_{length}, rotor_count{model == Model::M4 ? 4U : 3U}
+    {
+      detail::validate_key(model, model == Model::M4 ? ReflectorId::ThinB : ReflectorId::B, rotors);
+      const std::size_t left = this->rotor_count - 3U;
+      for (std::uint8_t ring{}; ring < ETW.size(); ++ring)
+      {
+        this->middle[ring] = detail::notches_of(rotors[left + 1U], ring);
+        this->right[ring]  = detail::notches_of(rotors[left + 2U], ring);
+      }
+    }
+
+    [[nodiscard]] auto length() const noexcept -> std::size_t { return this->length_; }
+
+    // The canonical setting equivalent to ringstellung and grundstellung (one letter per rotor each, std::invalid_argument
+    // otherwise), in uppercase letters
+    [[nodiscard]] auto canonical(std::string_view ringstellung, std::string_view grundstellung) const -> Setting
+    {
+      if (ringstellung.size() != this->rotor_count || grundstellung.size() != this->rotor_count)
+        throw std::invalid_argument("Expected one ring setting and one initial position per rotor");
+      std::array<std::uint8_t, 4> rings{};
+      std::array<std::uint8_t, 4> offsets{};
+      for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+      {
+        const std::uint8_t ring = detail::letter_index(ringstellung[rotor]);
+        offsets[rotor]          = static_cast<std::uint8_t>((detail::letter_index(grundstellung[rotor]) + ETW.size() - ring) % ETW.size());
+        rings[rotor]            = ring;
+      }
+
+      const std::size_t   left        = this->rotor_count - 3U;
+      const std::uint8_t  middle_ring = rings[left + 1U];
+      const std::uint8_t  right_ring  = rings[left + 2U];
+      const std::uint32_t visited     = this->middle_window(offsets[left + 1U], offsets[left + 2U], this->middle[middle_ring], this->right[right_ring]);
+      rings                           = {};
+      rings[left + 1U]                = smallest(this->middle, middle_ring, visited);
+      rings[left + 2U]                = smallest(this->right, right_ring, this->right_window(offsets[left + 2U]));
+
+      Setting setting;
+      for (std::size_t rotor{}; rotor < this->rotor_count; ++rotor)
+      {
+        setting.rings += static_cast<char>('A' + rings[rotor]);
+        setting.positions += static_cast<char>('A' + (offsets[rotor] + rings[rotor]) % ETW.size());
+      }
+      return setting;
+    }
+
+    // Settings of the rotor order, 26^6 on the M1 and M3 and 26^8 on the M4
+    [[nodiscard]] auto total() const noexcept -> std::uint64_t
+    {
+      std::uint64_t total = 1U;
+      for (std::size_t rotor{}; rotor < 2U * this->rotor_count; ++rotor)
+        total *= ETW.size();
+      return total;
+    }
+
+    // Canonical settings, counted by enumerating the notch classes of the middle and right rotor
+    [[nodiscard]] auto size() const noexcept -> std::uint64_t
+    {
+      std::uint64_t classes{};
+      this->classes([&classes](std::uint8_t, std::uint8_t, std::uint8_t, std::uint8_t) noexcept { ++classes; });
+      return classes * (this->rotor_count == 4U ? ETW.size() * ETW.size() : ETW.size());
+    }
+
+    [[nodiscard]] auto reduction() const noexcept -> double { return static_cast<double>(this->total()) / static_cast<double>(this->size()); }
+
+    // Calls visitor(rings, positions) with every canonical setting once, uppercase string views valid during the call
+    template<class Visitor>
+    auto forEach(Visitor &&visitor) const -> void
+    {
+      const std::size_t left = this->rotor_count - 3U;
+      std::string       rings(this->rotor_count, 'A');
+      std::string       positions(this->rotor_count, 'A');
+      this->classes([&](std::uint8_t middle_offset, std::uint8_t right_offset, std::uint8_t middle_ring, std::uint8_t right_ring) {
+        rings[left + 1U]     = static_cast<char>('A' + middle_ring);
+        rings[left + 2U]     = static_cast<char>('A' + right_ring);
+        positions[left + 1U] = static_cast<char>('A' + (middle_offset + middle_ring) % ETW.size());
+        positions[left + 2U] = static_cast<char>('A' + (right_offset + right_ring) % ETW.size());
+        for (std::size_t zusatzwalze{}; zusatzwalze < (left == 1U ? ETW.size() : 1U); ++zusatzwalze)
+        {
+          positions[0] = static_cast<char>('A' + zusatzwalze);
+          for (std::size_t offset{}; offset < ETW.size(); ++offset)
+          {
+            positions[left] = static_cast<char>('A' + offset);
+            visitor(std::string_view(rings), std::string_view(positions));
+          }
+        }
+      });
+    }
+
+    // Settings over canonical settings of every rotor order the model allows (Bombe::orders)
+    [[nodiscard]] static auto reduction(Model model, std::size_t length) -> double
+    {
+      // the number of classes only depends on the notch pattern of the middle and right rotor up to rotation
+      std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint64_t> sizes;
+      double                                                           total{};
+      double                                                           size{};
+      for (const auto &order : Bombe::orders(model))
+      {
+        const std::size_t left = order.size() - 3U;
+        const auto        key  = std::make_pair(pattern(order[left + 1U]), pattern(order[left + 2U]));
+        const Keyspace    keyspace(model, order, length);
+        auto              found = sizes.find(key);
+        if (found == sizes.end())
+          found = sizes.emplace(key, keyspace.size()).first;
+        total += static_cast<double>(keyspace.total());
+        size += static_cast<double>(found->second);
+      }
+      return total / size;
+    }
+
+  private:
+    static constexpr std::uint32_t all = (1U << 26U) - 1U;
+
+    // Notches of rotor rotated to the smallest mask
+    [[nodiscard]] static auto pattern(RotorId rotor) noexcept -> std::uint32_t
+    {
+      std::uint32_t result = all;
+      for (std::uint8_t ring{}; ring < ETW.size(); ++ring)
+        result = std::min(result, detail::notches_of(rotor, ring));
+      return result;
+    }
+
+    // Smallest ring whose notches agree with those of ring on visited
+    [[nodiscard]] static auto smallest(const std::array<std::uint32_t, 26> &notches, std::uint8_t ring, std::uint32_t visited) noexcept -> std::uint8_t
+    {
+      std::uint8_t candidate{};
+      while (((notches[candidate] ^ notches[ring]) & visited) != 0U)
+        ++candidate;
+      return candidate;
+    }
+
+    // Offsets the right rotor is looked at on: one per key press
+    [[nodiscard]] auto right_window(std::uint8_t offset) const noexcept -> std::uint32_t
+    {
+      if (this->length_ >= ETW.size())
+        return all;
+      const std::uint64_t window = ((std::uint64_t{1} << this->length_) - 1U) << offset;
+      return static_cast<std::uint32_t>((window | (window >> ETW.size())) & all);
+    }
+
+    // Offsets the middle rotor is looked at on, the rules of enmach::step without the left rotor. The middle rotor
+    // turns at least once every 26 key presses, so the loop ends after a few hundred presses at most.
+    [[nodiscard]] auto middle_window(std::uint8_t middle_offset, std::uint8_t right_offset, std::uint32_t middle_notches, std::uint32_t right_notches) const noexcept -> std::uint32_t
+    {
+      std::uint32_t visited{};
+      for (std::size_t press{}; press < this->length_ && visited != all; ++press)
+      {
+        visited |= 1U << middle_offset;
+        const bool turn = at_notch(right_notches, right_offset) || at_notch(middle_notches, middle_offset);
+        right_offset    = step_offset(right_offset, true);
+        middle_offset   = step_offset(middle_offset, turn);
+      }
+      return visited;
+    }
+
+    // Calls visit(middle offset, right offset, middle ring, right ring) once per canonical class; the left rotor and
+    // Zusatzwalze take no part in stepping, their offsets multiply the classes
+    template<class Visit>
+    auto classes(Visit &&visit) const -> void
+    {
+      for (std::uint8_t right_offset{}; right_offset < ETW.size(); ++right_offset)
+      {
+        const std::uint32_t right_visited = this->right_window(right_offset);
+        for (std::uint8_t right_ring{}; right_ring < ETW.size(); ++right_ring)
+        {
+          if (smallest(this->right, right_ring, right_visited) != right_ring)
+            continue;
+          for (std::uint8_t middle_offset{}; middle_offset < ETW.size(); ++middle_offset)
+            for (std::uint8_t middle_ring{}; middle_ring < ETW.size(); ++middle_ring)
+            {
+              const std::uint32_t visited = this->middle_window(middle_offset, right_offset, this->middle[middle_ring], this->right[right_ring]);
+              if (smallest(this->middle, middle_ring, visited) == middle_ring)
+                visit(middle_offset, right_offset, middle_ring, right_ring);
+            }
+        }
+      }
+    }
+
+    std::size_t                   length_;
+    std::size_t                   rotor_count;
+    // notches over effective offsets for every ring setting
+    std::array<std::uint32_t, 26> middle{};
+    std::array<std::uint32_t, 26> right{};
+  };
+} // namespace enmach
+
+#endif // ENMACH_KEYSPACE_HPP_
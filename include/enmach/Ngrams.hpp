@@ -0,0 +1,107 @@
+#ifndef ENMACH_NGRAMS_HPP_
+#define ENMACH_NGRAMS_HPP_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "enmach/common.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  // Probability that two letters drawn from a text with these letter counts are the same, about 0.038 for random
+  // letters and 0.066 (English) to 0.076 (German) for plaintext
+  [[nodiscard]] inline auto index_of_coincidence(const std::array<std::size_t, 26> &counts, std::size_t size) noexcept -> double
+  {
+    if (size < 2U)
+      return 0.0;
+    std::size_t pairs{};
+    for (const std::size_t count : counts)
+      if (count > 1U)
+        pairs += count * (count - 1U);
+    return static_cast<double>(pairs) / static_cast<double>(size * (size - 1U));
+  }
+
+  // letters holds indices 0-25
+  [[nodiscard]] inline auto index_of_coincidence(const std::uint8_t *letters, std::size_t size) noexcept -> double
+  {
+    std::array<std::size_t, 26> counts{};
+    for (std::size_t letter{}; letter < size; ++letter)
+      ++counts[letters[letter]];
+    return index_of_coincidence(counts, size);
+  }
+
+  // Log-probabilities of the letter n-grams of a language, counted from a corpus of it. Non-letters in the corpus are
+  // skipped, n-grams the corpus lacks get add-one smoothing instead of minus infinity.
+  class Ngrams
+  {
+  public:
+    // Throws std::invalid_argument unless n is 1 to 4 and the corpus holds at least one n-gram
+    Ngrams(std::string_view corpus, std::size_t n) : n_{n}
+    {
+      if (n == 0U || n > 4U)
+        throw std::invalid_argument("N-grams of 1 to 4 letters are supported");
+      std::size_t size = 1U;
+      for (std::size_t letter{}; letter < n; ++letter)
+        size *= ETW.size();
+
+      std::vector<std::uint32_t> counts(size);
+      std::size_t                index{};
+      std::size_t                letters{};
+      std::size_t                total{};
+      for (const char character : corpus)
+      {
+        if (!is_letter(character))
+          continue;
+        index = (index * ETW.size() + static_cast<std::size_t>(to_lowercase(character) - 'a')) % size;
+        if (++letters >= n)
+        {
+          ++counts[index];
+          ++total;
+        }
+      }
+      if (total == 0U)
+        throw std::invalid_argument("Corpus is shorter than one n-gram");
+
+      this->table.resize(size);
+      const double denominator = std::log(static_cast<double>(total + size));
+      for (std::size_t ngram{}; ngram < size; ++ngram)
+        this->table[ngram] = static_cast<float>(std::log(static_cast<double>(counts[ngram]) + 1.0) - denominator);
+    }
+
+    [[nodiscard]] auto n() const noexcept -> std::size_t { return this->n_; }
+
+    // Sum of the log-probabilities of every n-gram of letters (indices 0-25), higher is more like the corpus
+    [[nodiscard]] auto score(const std::uint8_t *letters, std::size_t size) const noexcept -> double
+    {
+      if (size < this->n_)
+        return 0.0;
+      double score{};
+      for (std::size_t letter{}; letter + this->n_ <= size; ++letter)
+        score += (*this)(letters + letter);
+      return score;
+    }
+
+    // Log-probability of the n letters (indices 0-25) at ngram
+    [[nodiscard]] auto operator()(const std::uint8_t *ngram) const noexcept -> double
+    {
+      std::size_t index = ngram[0];
+      for (std::size_t offset = 1U; offset < this->n_; ++offset)
+        index = index * ETW.size() + ngram[offset];
+      return static_cast<double>(this->table[index]);
+    }
+
+  private:
+    friend class PlugboardSearch;
+
+    std::size_t        n_;
+    std::vector<float> table;
+  };
+} // namespace enmach
+
+#endif // ENMACH_NGRAMS_HPP_
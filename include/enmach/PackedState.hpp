@@ -0,0 +1,64 @@
+#ifndef ENMACH_PACKEDSTATE_HPP_
+#define ENMACH_PACKEDSTATE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "enmach/common.hpp"
+#include "enmach/stepping.hpp"
+
+namespace enmach
+{
+  // Effective offsets of all rotors in one integer, one byte per rotor: the right rotor in byte 0, the middle one in
+  // byte 1, the left one in byte 2 and the Zusatzwalze (0 without one) in byte 3. Ring settings are not part of it.
+  struct PackedState
+  {
+    std::uint32_t value{};
+  };
+
+  [[nodiscard]] constexpr auto operator==(PackedState lhs, PackedState rhs) noexcept -> bool { return lhs.value == rhs.value; }
+
+  [[nodiscard]] constexpr auto operator!=(PackedState lhs, PackedState rhs) noexcept -> bool { return lhs.value != rhs.value; }
+
+  [[nodiscard]] constexpr auto operator<(PackedState lhs, PackedState rhs) noexcept -> bool { return lhs.value < rhs.value; }
+
+  [[nodiscard]] constexpr auto pack(const Odometer &odometer, std::uint8_t zusatzwalze = 0U) noexcept -> PackedState
+  {
+    return {static_cast<std::uint32_t>(zusatzwalze) << 24U | static_cast<std::uint32_t>(odometer.left) << 16U | static_cast<std::uint32_t>(odometer.middle) << 8U | odometer.right};
+  }
+
+  [[nodiscard]] constexpr auto unpack(PackedState state) noexcept -> Odometer
+  {
+    return {static_cast<std::uint8_t>(state.value >> 16U), static_cast<std::uint8_t>(state.value >> 8U), static_cast<std::uint8_t>(state.value)};
+  }
+
+  [[nodiscard]] constexpr auto zusatzwalze(PackedState state) noexcept -> std::uint8_t { return static_cast<std::uint8_t>(state.value >> 24U); }
+
+  // Every byte holds an offset below 26
+  [[nodiscard]] constexpr auto is_valid(PackedState state) noexcept -> bool
+  {
+    for (std::uint32_t value = state.value; value != 0U; value >>= 8U)
+      if ((value & 0xffU) >= ETW.size())
+        return false;
+    return true;
+  }
+} // namespace enmach
+
+template<>
+struct std::hash<enmach::PackedState>
+{
+  // Murmur3 finalizer, the low bytes alone vary too little for power of two bucket counts
+  [[nodiscard]] auto operator()(enmach::PackedState state) const noexcept -> std::size_t
+  {
+    std::uint32_t value = state.value;
+    value ^= value >> 16U;
+    value *= 0x85ebca6bU;
+    value ^= value >> 13U;
+    value *= 0xc2b2ae35U;
+    value ^= value >> 16U;
+    return value;
+  }
+};
+
+#endif // ENMACH_PACKEDSTATE_HPP_
@@ -0,0 +1,350 @@
+#ifndef ENMACH_PLUGBOARDSEARCH_HPP_
+#define ENMACH_PLUGBOARDSEARCH_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "enmach/CompiledKey.hpp"
+#include "enmach/Ngrams.hpp"
+#include "enmach/Steckerbrett.hpp"
+#include "enmach/common.hpp"
+#include "enmach/input.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  // Plugboard of a ciphertext whose rotor setting is known. The scrambler permutation (everything but the plugboard)
+  // at every letter is computed once. A plugboard trial then deciphers only the letters that pass through a contact it
+  // changes, found through an index of the message by cipher letter and by scrambler output, and updates the score by
+  // the difference those letters make.
+  class PlugboardSearch
+  {
+  public:
+    // ciphertext holds letters only (std::invalid_argument otherwise) and starts at the key's position 0. The
+    // plugboard of the key is ignored, the search starts without plugs.
+    PlugboardSearch(const CompiledKey &key, std::string_view ciphertext)
+    {
+      if (input::count_letters(ciphertext.data(), ciphertext.data() + ciphertext.size()) != ciphertext.size())
+        throw std::invalid_argument("Ciphertext must hold letters only");
+      this->cipher.resize(ciphertext.size());
+      for (std::size_t letter{}; letter < ciphertext.size(); ++letter)
+        this->cipher[letter] = static_cast<std::uint8_t>(to_lowercase(ciphertext[letter]) - 'a');
+
+      // one message per letter of the alphabet gives the scrambler at every letter, the key's own plugboard is
+      // undone on both sides
+      const Steckerbrett::Table &own = key.plugboard;
+      this->scramblers.resize(ciphertext.size());
+      std::string repeated(ciphertext.size(), '\0');
+      std::string buffer(ciphertext.size(), '\0');
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+      {
+        std::fill(repeated.begin(), repeated.end(), static_cast<char>('a' + own[letter]));
+        Cursor cursor = key.cursor();
+        key.transform<input::Unchecked>(cursor, repeated, buffer.data());
+        for (std::size_t index{}; index < buffer.size(); ++index)
+          this->scramblers[index][letter] = own[static_cast<std::size_t>(buffer[index] - 'a')];
+      }
+      index_letters(this->cipher, this->by_cipher);
+
+      this->plaintext_.resize(ciphertext.size());
+      this->visited.resize(ciphertext.size());
+      // one spare word so that every word has a next one
+      this->dirty.resize(ciphertext.size() / 64U + 2U);
+      this->setPlugs(Steckerbrett().table());
+    }
+
+    [[nodiscard]] auto plugs() const noexcept -> const Steckerbrett::Table & { return this->plugs_; }
+
+    // Deciphered message (indices 0-25) under plugs()
+    [[nodiscard]] auto plaintext() const noexcept -> const std::vector<std::uint8_t> & { return this->plaintext_; }
+
+    // plugs must be an involution
+    auto setPlugs(const Steckerbrett::Table &plugs) -> void
+    {
+      this->plugs_ = plugs;
+      for (std::size_t letter{}; letter < this->cipher.size(); ++letter)
+        this->plaintext_[letter] = this->plugs_[this->scramblers[letter][this->plugs_[this->cipher[letter]]]];
+      this->index_middles();
+    }
+
+    [[nodiscard]] auto score(const Ngrams &ngrams) const noexcept -> double { return ngrams.score(this->plaintext_.data(), this->plaintext_.size()); }
+
+    // Greedy over all letter pairs until no single change improves the score: unplug a pair, plug two letters
+    // (unplugging their partners) or plug them and their former partners crosswise. Returns the final score.
+    auto climb(const Ngrams &ngrams) -> double
+    {
+      NgramScore scorer{ngrams, {}, {}, {}};
+      this->climb_with(scorer);
+      return this->score(ngrams);
+    }
+
+    // The same with the index of coincidence of the plaintext as the score, which needs no language statistics and
+    // is updated per changed letter rather than per n-gram
+    auto climbIndexOfCoincidence() -> double
+    {
+      CoincidenceScore scorer{};
+      this->climb_with(scorer);
+      return index_of_coincidence(this->plaintext_.data(), this->plaintext_.size());
+    }
+
+  private:
+    // Positions of the message sorted by a letter at each of them, positions[offsets[l]] up to positions[offsets[l + 1]]
+    // hold letter l
+    struct LetterIndex
+    {
+      std::array<std::uint32_t, 27> offsets;
+      std::vector<std::uint32_t>    positions;
+    };
+
+    struct Change
+    {
+      std::uint32_t position;
+      // the letter before the trial
+      std::uint8_t  plain;
+    };
+
+    // Sum of the n-gram log-probabilities, the n-grams holding a dirty letter are rescored
+    struct NgramScore
+    {
+      const Ngrams                                &ngrams;
+      // by start
+      std::vector<float>                           windows;
+      std::vector<std::pair<std::uint32_t, float>> rescored;
+      std::size_t                                  rescores;
+
+      auto reset(const PlugboardSearch &search) -> void
+      {
+        this->windows.clear();
+        for (std::size_t start{}; start + this->ngrams.n() <= search.plaintext_.size(); ++start)
+          this->windows.push_back(static_cast<float>(this->ngrams(search.plaintext_.data() + start)));
+        this->rescored.resize(this->windows.size());
+      }
+
+      auto delta(const PlugboardSearch &search, std::size_t) -> double
+      {
+        // an n-gram starting at most n - 1 letters before a dirty one changes, the next word holds the dirty letters
+        // of the n-grams that start near the end of a word
+        const std::size_t   n      = this->ngrams.n();
+        const float *const  table  = this->ngrams.table.data();
+        const std::uint8_t *text   = search.plaintext_.data();
+        const float *const  cached = this->windows.data();
+        double              delta{};
+        this->rescores = 0U;
+        for (std::size_t word{}; word + 1U < search.dirty.size(); ++word)
+        {
+          const std::uint64_t letters = search.dirty[word];
+          const std::uint64_t next    = search.dirty[word + 1U];
+          std::uint64_t       starts  = letters;
+          for (std::size_t shift = 1U; shift < n; ++shift)
+            starts |= letters >> shift | next << (64U - shift);
+          for (; starts != 0U; starts &= starts - 1U)
+          {
+            const std::size_t start = word * 64U + input::detail::trailing_zeros(starts);
+            if (start >= this->windows.size())
+              break;
+            std::size_t index = text[start];
+            for (std::size_t offset = 1U; offset < n; ++offset)
+              index = index * ETW.size() + text[start + offset];
+            delta += static_cast<double>(table[index]) - static_cast<double>(cached[start]);
+            this->rescored[this->rescores++] = {static_cast<std::uint32_t>(start), table[index]};
+          }
+        }
+        return delta;
+      }
+
+      auto keep(const PlugboardSearch &, std::size_t) -> void
+      {
+        for (std::size_t window{}; window < this->rescores; ++window)
+          this->windows[this->rescored[window].first] = this->rescored[window].second;
+      }
+
+      auto discard(const PlugboardSearch &, std::size_t) -> void {}
+    };
+
+    // Number of ordered pairs of equal letters, proportional to the index of coincidence
+    struct CoincidenceScore
+    {
+      std::array<std::int64_t, 26> counts;
+
+      auto reset(const PlugboardSearch &search) -> void
+      {
+        this->counts.fill(0);
+        for (const std::uint8_t letter : search.plaintext_)
+          ++this->counts[letter];
+      }
+
+      // c letters make c (c - 1) pairs, one more makes 2 c more
+      auto delta(const PlugboardSearch &search, std::size_t visits) -> double
+      {
+        std::int64_t delta{};
+        for (std::size_t visit{}; visit < visits; ++visit)
+        {
+          const Change &change = search.visited[visit];
+          delta -= 2 * --this->counts[change.plain];
+          delta += 2 * this->counts[search.plaintext_[change.position]]++;
+        }
+        return static_cast<double>(delta);
+      }
+
+      auto keep(const PlugboardSearch &, std::size_t) -> void {}
+
+      auto discard(const PlugboardSearch &search, std::size_t visits) -> void
+      {
+        for (std::size_t visit{}; visit < visits; ++visit)
+        {
+          const Change &change = search.visited[visit];
+          --this->counts[search.plaintext_[change.position]];
+          ++this->counts[change.plain];
+        }
+      }
+    };
+
+    static auto index_letters(const std::vector<std::uint8_t> &letters, LetterIndex &index) -> void
+    {
+      index.offsets.fill(0U);
+      for (const std::uint8_t letter : letters)
+        ++index.offsets[letter + 1U];
+      for (std::size_t letter{}; letter < ETW.size(); ++letter)
+        index.offsets[letter + 1U] += index.offsets[letter];
+      index.positions.resize(letters.size());
+      std::array<std::uint32_t, 27> next = index.offsets;
+      for (std::size_t position{}; position < letters.size(); ++position)
+        index.positions[next[letters[position]]++] = static_cast<std::uint32_t>(position);
+    }
+
+    // the letter between the scrambler and the output plug changes whenever plugs_ does
+    auto index_middles() -> void
+    {
+      this->middles.resize(this->cipher.size());
+      for (std::size_t letter{}; letter < this->cipher.size(); ++letter)
+        this->middles[letter] = this->scramblers[letter][this->plugs_[this->cipher[letter]]];
+      index_letters(this->middles, this->by_middle);
+    }
+
+    template<class Scorer>
+    auto climb_with(Scorer &scorer) -> void
+    {
+      const auto unplug = [](Steckerbrett::Table &table, std::uint8_t letter) {
+        table[table[letter]] = table[letter];
+        table[letter]        = letter;
+      };
+
+      scorer.reset(*this);
+      bool improved = true;
+      while (improved)
+      {
+        improved = false;
+        for (std::uint8_t first{}; first < ETW.size(); ++first)
+          for (auto second = static_cast<std::uint8_t>(first + 1U); second < ETW.size(); ++second)
+          {
+            std::array<Steckerbrett::Table, 2> trials{this->plugs_, this->plugs_};
+            std::size_t                     count = 1U;
+            const std::uint8_t              a     = this->plugs_[first];
+            const std::uint8_t              b     = this->plugs_[second];
+            if (a == second)
+              unplug(trials[0], first);
+            else
+            {
+              unplug(trials[0], first);
+              unplug(trials[0], second);
+              trials[1]         = trials[0];
+              trials[0][first]  = second;
+              trials[0][second] = first;
+              if (a != first && b != second)
+              {
+                trials[1][first]  = second;
+                trials[1][second] = first;
+                trials[1][a]      = b;
+                trials[1][b]      = a;
+                count             = 2U;
+              }
+            }
+            const std::array<std::uint8_t, 4> touched{first, second, a, b};
+            for (std::size_t trial{}; trial < count; ++trial)
+              if (this->attempt(trials[trial], touched, scorer))
+              {
+                improved = true;
+                break;
+              }
+          }
+      }
+    }
+
+    // Keeps trial if it scores better than plugs_, touched holds every letter trial plugs differently. A letter of the
+    // message changes only if its cipher letter or the scrambler output for it is plugged differently.
+    template<class Scorer>
+    auto attempt(const Steckerbrett::Table &trial, const std::array<std::uint8_t, 4> &touched, Scorer &scorer) -> bool
+    {
+      std::uint32_t replugged{};
+      for (const std::uint8_t letter : touched)
+        if (trial[letter] != this->plugs_[letter])
+          replugged |= 1U << letter;
+      if (replugged == 0U)
+        return false;
+
+      // deciphered in place, visited keeps the letters replaced and dirty marks the ones that differ; the pointers
+      // are hoisted since the byte stores could alias the vectors
+      std::size_t                               visits{};
+      std::uint8_t *const                       text    = this->plaintext_.data();
+      const std::uint8_t *const                 letters = this->cipher.data();
+      const std::array<std::uint8_t, 26> *const rows    = this->scramblers.data();
+      Change *const                             changes = this->visited.data();
+      std::uint64_t *const                      words   = this->dirty.data();
+      for (const LetterIndex *index : {&this->by_cipher, &this->by_middle})
+      {
+        // positions whose cipher letter is replugged are deciphered once, through by_cipher
+        const std::uint32_t skipped = index == &this->by_middle ? replugged : 0U;
+        for (std::uint32_t pending = replugged; pending != 0U; pending &= pending - 1U)
+        {
+          const auto letter = input::detail::trailing_zeros(pending);
+          for (std::uint32_t entry = index->offsets[letter]; entry < index->offsets[letter + 1U]; ++entry)
+          {
+            const std::uint32_t position = index->positions[entry];
+            if ((skipped >> letters[position] & 1U) != 0U)
+              continue;
+            const std::uint8_t plain = trial[rows[position][trial[letters[position]]]];
+            changes[visits++]        = {position, text[position]};
+            words[position / 64U] |= static_cast<std::uint64_t>(plain != text[position]) << position % 64U;
+            text[position] = plain;
+          }
+        }
+      }
+
+      const double delta = scorer.delta(*this, visits);
+      for (std::size_t visit{}; visit < visits; ++visit)
+        words[changes[visit].position / 64U] = 0U;
+      if (delta > 0.0)
+      {
+        this->plugs_ = trial;
+        this->index_middles();
+        scorer.keep(*this, visits);
+        return true;
+      }
+      scorer.discard(*this, visits);
+      for (std::size_t visit{}; visit < visits; ++visit)
+        text[changes[visit].position] = changes[visit].plain;
+      return false;
+    }
+
+    std::vector<std::uint8_t>                 cipher;
+    std::vector<std::array<std::uint8_t, 26>> scramblers;
+    Steckerbrett::Table                       plugs_{};
+    std::vector<std::uint8_t>                 plaintext_;
+    std::vector<std::uint8_t>                 middles;
+    LetterIndex                               by_cipher{};
+    LetterIndex                               by_middle{};
+    // scratch of attempt, dirty has a bit per letter of the message and is all zeros between trials
+    std::vector<Change>                       visited;
+    std::vector<std::uint64_t>                dirty;
+  };
+} // namespace enmach
+
+#endif // ENMACH_PLUGBOARDSEARCH_HPP_
@@ -2,6 +2,7 @@
 #define ENMACH_ROTOR_HPP_
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 
@@ -65,36 +66,97 @@ namespace enmach::rotor_tags
   // clang-format on
 } // namespace enmach::rotor_tags
 
-namespace enmach
+namespace enmach::rotor_engine
 {
+  using Wiring        = std::array<std::uint8_t, 26>;
+  using ShiftedWiring = std::array<Wiring, 26>;
+
+  // shifted[offset][contact] = (wiring[(contact + offset) % 26] - offset) % 26
+  [[nodiscard]] constexpr auto make_shifted_wiring(const Wiring &wiring) noexcept -> ShiftedWiring
+  {
+    ShiftedWiring shifted{};
+    for (std::size_t offset{}; offset < ETW.size(); ++offset)
+      for (std::size_t contact{}; contact < ETW.size(); ++contact)
+        shifted[offset][contact] = static_cast<std::uint8_t>((wiring[(contact + offset) % ETW.size()] + ETW.size() - offset) % ETW.size());
+    return shifted;
+  }
+
   template<class RotorTag>
-  struct Rotor
+  inline constexpr ShiftedWiring forward_table = make_shifted_wiring(RotorTag::fvalue);
+
+  template<class RotorTag>
+  inline constexpr ShiftedWiring inverse_table = make_shifted_wiring(RotorTag::rvalue);
+
+  // Shifts the contact into and out of the wiring on every pass
+  struct Arithmetic
   {
-  public:
-    [[nodiscard]] constexpr auto forward(std::uint8_t index) const noexcept -> std::uint8_t
+    template<class RotorTag>
+    [[nodiscard]] constexpr static auto forward(std::uint8_t offset, std::uint8_t index) noexcept -> std::uint8_t
     {
-      index = (index + this->effective_offset) % enmach::ETW.size();
+      index = static_cast<std::uint8_t>((index + offset) % enmach::ETW.size());
       index = RotorTag::fvalue[index];
-      index = (index + enmach::ETW.size() - this->effective_offset) % enmach::ETW.size();
+      index = static_cast<std::uint8_t>((index + enmach::ETW.size() - offset) % enmach::ETW.size());
       return index;
     }
 
-    [[nodiscard]] constexpr auto inverse(std::uint8_t index) const noexcept -> std::uint8_t
+    template<class RotorTag>
+    [[nodiscard]] constexpr static auto inverse(std::uint8_t offset, std::uint8_t index) noexcept -> std::uint8_t
     {
-      index = (index + this->effective_offset) % enmach::ETW.size();
+      index = static_cast<std::uint8_t>((index + offset) % enmach::ETW.size());
       index = RotorTag::rvalue[index];
-      index = (index + enmach::ETW.size() - this->effective_offset) % enmach::ETW.size();
+      index = static_cast<std::uint8_t>((index + enmach::ETW.size() - offset) % enmach::ETW.size());
       return index;
     }
+  };
+
+  // Looks the contact up in the wiring pre-shifted for every offset
+  struct Table
+  {
+    template<class RotorTag>
+    [[nodiscard]] constexpr static auto forward(std::uint8_t offset, std::uint8_t index) noexcept -> std::uint8_t { return forward_table<RotorTag>[offset][index]; }
+
+    template<class RotorTag>
+    [[nodiscard]] constexpr static auto inverse(std::uint8_t offset, std::uint8_t index) noexcept -> std::uint8_t { return inverse_table<RotorTag>[offset][index]; }
+  };
+} // namespace enmach::rotor_engine
+
+namespace enmach
+{
+  template<class RotorTag, class Engine = rotor_engine::Table>
+  struct Rotor
+  {
+  public:
+    [[nodiscard]] constexpr auto forward(std::uint8_t index) const noexcept -> std::uint8_t { return Engine::template forward<RotorTag>(this->effective_offset, index); }
+
+    [[nodiscard]] constexpr auto inverse(std::uint8_t index) const noexcept -> std::uint8_t { return Engine::template inverse<RotorTag>(this->effective_offset, index); }
 
     [[nodiscard]] constexpr auto increment(const bool should_step, const bool can_propagate) noexcept -> bool
     {
-      const bool result = RotorTag::turn((this->effective_offset + this->ringstellung_) % ETW.size());
+      const bool result = RotorTag::turn(static_cast<std::uint8_t>((this->effective_offset + this->ringstellung_) % ETW.size()));
       if constexpr (!std::is_same_v<RotorTag, enmach::rotor_tags::GAMMA> && !std::is_same_v<RotorTag, enmach::rotor_tags::BETA>)
-        this->effective_offset = (this->effective_offset + static_cast<std::uint8_t>(should_step || (result && can_propagate))) % enmach::ETW.size();
+        this->effective_offset = static_cast<std::uint8_t>((this->effective_offset + static_cast<std::uint8_t>(should_step || (result && can_propagate))) % enmach::ETW.size());
+      return result;
+    }
+
+    [[nodiscard]] constexpr auto atNotch() const noexcept -> bool { return RotorTag::turn(static_cast<std::uint8_t>((this->effective_offset + this->ringstellung_) % ETW.size())); }
+
+    // Bit i is set when the rotor sits on a turnover notch at effective offset i
+    [[nodiscard]] constexpr auto notches() const noexcept -> std::uint32_t
+    {
+      std::uint32_t result{};
+      for (std::uint8_t offset{}; offset < ETW.size(); ++offset)
+        if (RotorTag::turn(static_cast<std::uint8_t>((offset + this->ringstellung_) % ETW.size())))
+          result |= 1U << offset;
       return result;
     }
 
+    [[nodiscard]] constexpr auto effectiveOffset() const noexcept -> std::uint8_t { return this->effective_offset; }
+
+    constexpr auto setEffectiveOffset(std::uint8_t offset) noexcept -> void { this->effective_offset = static_cast<std::uint8_t>(offset % ETW.size()); }
+
+    // One position on, without looking at the notch (the right rotor of a bulk transform)
+    constexpr auto step() noexcept -> void { this->effective_offset = static_cast<std::uint8_t>(this->effective_offset + 1U == ETW.size() ? 0U : this->effective_offset + 1U); }
+
     template<class T>
     constexpr auto setGrundstellung(T grundstellung) -> void
     {
@@ -116,7 +178,7 @@ namespace enmach
     }
 
   private:
-    constexpr auto setInternalDifference() noexcept -> void { this->effective_offset = (this->grundstellung_ + enmach::ETW.size() - this->ringstellung_) % enmach::ETW.size(); }
+    constexpr auto setInternalDifference() noexcept -> void { this->effective_offset = static_cast<std::uint8_t>((this->grundstellung_ + enmach::ETW.size() - this->ringstellung_) % enmach::ETW.size()); }
 
     std::uint8_t grundstellung_{};
     std::uint8_t ringstellung_{};
@@ -0,0 +1,99 @@
+#ifndef ENMACH_STECKERBRETT_HPP_
+#define ENMACH_STECKERBRETT_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "enmach/common.hpp"
+#include "enmach/utils.hpp"
+
+namespace enmach
+{
+  // Plugboard (Steckerbrett) as a 26-entry index table, validated once on construction
+  class Steckerbrett
+  {
+  public:
+    using Table = std::array<std::uint8_t, 26>;
+
+    // No cables plugged
+    constexpr Steckerbrett() noexcept
+    {
+      for (std::uint8_t index{}; index < ETW.size(); ++index)
+        this->table_[index] = index;
+    }
+
+    // Up to 13 letter pairs, optionally separated by spaces ("AV BS CG"). Usable in constant expressions, where an
+    // invalid argument fails to compile instead of throwing std::invalid_argument.
+    constexpr explicit Steckerbrett(std::string_view pairs) : Steckerbrett()
+    {
+      char pending{};
+      for (const char character : pairs)
+      {
+        if (character == ' ')
+          continue;
+        if (!is_letter(character))
+          throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
+        if (pending == '\0')
+        {
+          pending = character;
+          continue;
+        }
+        this->plug(pending, character);
+        pending = '\0';
+      }
+      // more than 13 pairs necessarily plug a letter twice
+      if (pending != '\0')
+        throw std::invalid_argument("Plugboard expects letter pairs");
+    }
+
+    [[nodiscard]] constexpr auto operator()(char letter) const -> char
+    {
+      if (!is_letter(letter))
+        throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
+      return static_cast<char>('a' + this->table_[static_cast<std::uint8_t>(to_lowercase(letter) - 'a')]);
+    }
+
+    [[nodiscard]] constexpr auto operator[](std::uint8_t index) const noexcept -> std::uint8_t { return this->table_[index]; }
+
+    [[nodiscard]] constexpr auto table() const noexcept -> const Table & { return this->table_; }
+
+  private:
+    constexpr auto plug(char first, char second) -> void
+    {
+      const auto lhs = static_cast<std::uint8_t>(to_lowercase(first) - 'a');
+      const auto rhs = static_cast<std::uint8_t>(to_lowercase(second) - 'a');
+      if (lhs == rhs || this->table_[lhs] != lhs || this->table_[rhs] != rhs)
+        throw std::invalid_argument("Each letter can be plugged at most once");
+      this->table_[lhs] = rhs;
+      this->table_[rhs] = lhs;
+    }
+
+    Table table_{};
+  };
+
+  // Index table of any plugboard, either an enmach::Steckerbrett or a functor mapping 'a'-'z' to 'a'-'z'
+  template<class AnyPlugboard>
+  [[nodiscard]] constexpr auto make_plug_table(const AnyPlugboard &plugboard) -> Steckerbrett::Table
+  {
+    if constexpr (std::is_same_v<AnyPlugboard, Steckerbrett>)
+      return plugboard.table();
+    else
+    {
+      Steckerbrett::Table table{};
+      for (std::uint8_t index{}; index < ETW.size(); ++index)
+      {
+        const char letter = plugboard(static_cast<char>('a' + index));
+        if (!is_lowercase(letter))
+          throw std::invalid_argument("Plugboard must map every letter to a lowercase letter (a-z)");
+        table[index] = static_cast<std::uint8_t>(letter - 'a');
+      }
+      return table;
+    }
+  }
+} // namespace enmach
+
+#endif // ENMACH_STECKERBRETT_HPP_
@@ -0,0 +1,111 @@
+#ifndef ENMACH_STEPSEQUENCE_HPP_
+#define ENMACH_STEPSEQUENCE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "enmach/stepping.hpp"
+
+namespace enmach
+{
+  // Every state the stepping rotors go through from a start state, computed once so that stepping becomes an index
+  // increment. The stepping is not injective (double step), so the states form a tail followed by a cycle, which is
+  // about 16,900 key presses long for single notch rotors.
+  class StepSequence
+  {
+  public:
+    // Offsets after a key press, moved is set when the middle or left rotor may have stepped on it
+    struct State
+    {
+      std::uint8_t left{};
+      std::uint8_t middle{};
+      std::uint8_t right{};
+      bool         moved{};
+    };
+
+    StepSequence(const Odometer &start, const Notches &notches) : start_{start}, notches_{notches}
+    {
+      constexpr std::uint32_t    unseen = ~std::uint32_t{};
+      std::vector<std::uint32_t> seen(ETW.size() * ETW.size() * ETW.size(), unseen);
+
+      Odometer odometer = start;
+      for (;;)
+      {
+        auto &index = seen[(odometer.left * ETW.size() + odometer.middle) * ETW.size() + odometer.right];
+        if (index != unseen)
+        {
+          this->loop_ = index;
+          break;
+        }
+        index = static_cast<std::uint32_t>(this->states_.size());
+        this->states_.push_back({odometer.left, odometer.middle, odometer.right, false});
+        step(odometer, notches);
+      }
+
+      for (std::size_t i = 1U; i < this->states_.size(); ++i)
+        this->states_[i].moved = stepped(this->states_[i - 1U], this->states_[i]);
+      this->states_[this->loop_].moved = this->states_[this->loop_].moved || stepped(this->states_.back(), this->states_[this->loop_]);
+    }
+
+    [[nodiscard]] auto start() const noexcept -> const Odometer & { return this->start_; }
+
+    [[nodiscard]] auto notches() const noexcept -> const Notches & { return this->notches_; }
+
+    // Distinct states, the start state included
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return this->states_.size(); }
+
+    // Length of the cycle the states end up in
+    [[nodiscard]] auto period() const noexcept -> std::size_t { return this->states_.size() - this->loop_; }
+
+    // Index of the state after count key presses
+    [[nodiscard]] auto index(std::uint64_t count) const noexcept -> std::size_t
+    {
+      if (count < this->states_.size())
+        return static_cast<std::size_t>(count);
+      return this->loop_ + static_cast<std::size_t>((count - this->loop_) % this->period());
+    }
+
+    // Index of the state one key press after the one at index
+    [[nodiscard]] auto next(std::size_t index) const noexcept -> std::size_t { return ++index == this->states_.size() ? this->loop_ : index; }
+
+    [[nodiscard]] auto operator[](std::size_t index) const noexcept -> const State & { return this->states_[index]; }
+
+  private:
+    [[nodiscard]] constexpr static auto stepped(const State &from, const State &to) noexcept -> bool { return from.middle != to.middle || from.left != to.left; }
+
+    Odometer           start_{};
+    Notches            notches_{};
+    std::vector<State> states_;
+    std::size_t        loop_{};
+  };
+
+  // Evaluates the notches on every key press
+  struct NotchStepper
+  {
+    Odometer odometer;
+    Notches  notches;
+
+    constexpr auto next() noexcept -> StepSequence::State
+    {
+      const bool moved = at_notch(this->notches.right, this->odometer.right) || at_notch(this->notches.middle, this->odometer.middle);
+      step(this->odometer, this->notches);
+      return {this->odometer.left, this->odometer.middle, this->odometer.right, moved};
+    }
+  };
+
+  // Reads the key presses from a precomputed sequence
+  struct SequenceStepper
+  {
+    const StepSequence &sequence;
+    std::size_t         index;
+
+    auto next() noexcept -> const StepSequence::State &
+    {
+      this->index = this->sequence.next(this->index);
+      return this->sequence[this->index];
+    }
+  };
+} // namespace enmach
+
+#endif // ENMACH_STEPSEQUENCE_HPP_
@@ -0,0 +1,327 @@
+#ifndef ENMACH_TABLECACHE_HPP_
+#define ENMACH_TABLECACHE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "enmach/CompiledKey.hpp"
+#include "enmach/common.hpp"
+
+namespace enmach
+{
+  namespace detail
+  {
+    inline constexpr std::array<char, 8> table_cache_magic   = {'E', 'N', 'M', 'A', 'C', 'H', 'T', 'B'};
+    inline constexpr std::uint32_t       table_cache_version = 2U;
+
+    // Written in native byte order: the file is a cache for the machine that generated it, not an exchange format
+    struct TableCacheHeader
+    {
+      std::array<char, 8> magic;
+      std::uint32_t       version;
+      std::uint32_t       model;
+      std::uint64_t       wiring;
+      std::uint64_t       size;
+      std::uint64_t       checksum;
+      std::array<char, 24> reserved;
+    };
+    static_assert(sizeof(TableCacheHeader) == 64U);
+
+    // FNV-1a over 64-bit words, the payload is a whole number of words
+    [[nodiscard]] inline auto table_checksum(const std::uint8_t *data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ULL) noexcept -> std::uint64_t
+    {
+      for (std::size_t offset{}; offset + 8U <= size; offset += 8U)
+      {
+        std::uint64_t word{};
+        std::memcpy(&word, data + offset, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    // Every wiring the tables are built from, a file generated from other rotor_tags/ukw values is rejected
+    [[nodiscard]] inline auto wiring_fingerprint(Model model) noexcept -> std::uint64_t
+    {
+      std::uint64_t hash = 0xcbf29ce484222325ULL;
+      const auto    mix  = [&hash](const std::array<std::uint8_t, 26> &wiring) {
+        for (const std::uint8_t contact : wiring)
+          hash = (hash ^ contact) * 0x100000001b3ULL;
+      };
+      hash = (hash ^ static_cast<std::uint8_t>(model)) * 0x100000001b3ULL;
+      for (const auto &rotor : rotor_wirings)
+        mix(*rotor.fvalue);
+      for (const auto &reflector : reflector_wirings)
+        mix(*reflector.value);
+      return hash;
+    }
+  } // namespace detail
+
+  // Core permutations (every rotor but the rightmost one and the reflector, see EnigmaMachine::rebuild_core) for all
+  // rotor orders, reflectors and offsets of a model, precomputed once into a file that every process maps read-only.
+  // Keys compiled through it copy the core from the page cache whenever the middle rotor steps instead of recomputing it.
+  // An M1 file is 1.1 MB, M3 3.0 MB and M4 (both Zusatzwalzen at every offset) 102 MB. open() only checks the header, so
+  // a process pays for the pages it touches; verify() and openOrGenerate read the whole payload against its checksum.
+  class TableCache : public std::enable_shared_from_this<TableCache>
+  {
+  public:
+    TableCache(const TableCache &)                     = delete;
+    auto operator=(const TableCache &) -> TableCache & = delete;
+
+    ~TableCache()
+    {
+      ::munmap(this->data, this->length);
+    }
+
+    // Throws std::system_error when path cannot be read or mapped and std::invalid_argument when it is not a table file
+    // of this version, was built from other wirings or has the wrong size
+    [[nodiscard]] static auto open(const std::string &path) -> std::shared_ptr<const TableCache>
+    {
+      return std::shared_ptr<const TableCache>(new TableCache(path));
+    }
+
+    // Builds the tables of model into path. They are written to a temporary file that is read back against its checksum
+    // and renamed into place, so concurrent readers and generators never see a partial file.
+    static auto generate(const std::string &path, Model model) -> void
+    {
+      const Layout layout(model);
+      const auto   temporary = path + ".tmp" + std::to_string(::getpid());
+      {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        detail::TableCacheHeader header{detail::table_cache_magic, detail::table_cache_version, static_cast<std::uint32_t>(model), detail::wiring_fingerprint(model), layout.size(), 0xcbf29ce484222325ULL, {}};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        std::vector<std::uint8_t> block(layout.block);
+        for (std::size_t reflector{}; reflector < layout.reflectors.size(); ++reflector)
+          for (std::size_t zusatzwalze{}; zusatzwalze < layout.zusatzwalzen.size(); ++zusatzwalze)
+            for (std::size_t left{}; left < layout.rotors; ++left)
+              for (std::size_t middle{}; middle < layout.rotors; ++middle)
+              {
+                if (left == middle)
+                  continue;
+                fill_block(block.data(), layout, layout.reflectors[reflector], layout.zusatzwalzen[zusatzwalze], static_cast<RotorId>(left), static_cast<RotorId>(middle));
+                header.checksum = detail::table_checksum(block.data(), block.size(), header.checksum);
+                file.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size()));
+              }
+        file.seekp(0);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.close();
+        if (!file)
+        {
+          std::remove(temporary.c_str());
+          throw std::runtime_error("Cannot write table cache " + path);
+        }
+      }
+      try
+      {
+        if (!open(temporary)->verify())
+          throw std::runtime_error("Table cache " + path + " does not match its checksum after writing");
+      }
+      catch (...)
+      {
+        std::remove(temporary.c_str());
+        throw;
+      }
+      if (std::rename(temporary.c_str(), path.c_str()) != 0)
+      {
+        const int error = errno;
+        std::remove(temporary.c_str());
+        throw std::system_error(error, std::generic_category(), "Cannot rename table cache to " + path);
+      }
+    }
+
+    // Maps path, generating it first when it does not exist yet. An existing file is verified once, std::invalid_argument
+    // when its payload does not match the checksum.
+    [[nodiscard]] static auto openOrGenerate(const std::string &path, Model model) -> std::shared_ptr<const TableCache>
+    {
+      const bool generated = ::access(path.c_str(), F_OK) != 0;
+      if (generated)
+        generate(path, model);
+      auto tables = open(path);
+      if (tables->model() != model)
+        throw std::invalid_argument("Table cache " + path + " was generated for another model");
+      if (!generated && !tables->verify())
+        throw std::invalid_argument("Corrupted table cache: " + path);
+      return tables;
+    }
+
+    [[nodiscard]] auto model() const noexcept -> Model { return this->layout.model; }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return this->length; }
+
+    // Whether the payload matches the checksum in the header, reads in every page of the file
+    [[nodiscard]] auto verify() const noexcept -> bool
+    {
+      detail::TableCacheHeader header{};
+      std::memcpy(&header, this->data, sizeof(header));
+      return detail::table_checksum(static_cast<const std::uint8_t *>(this->data) + sizeof(header), header.size) == header.checksum;
+    }
+
+    // Same arguments as the CompiledKey constructor. Keys whose rotors or reflector are not in this file (an M3 rotor
+    // order on an M1 file) compute their cores as usual, they only lose the speedup.
+    [[nodiscard]] auto compile(Model model, ReflectorId reflector, const std::vector<RotorId> &rotors, std::string_view ringstellung, std::string_view grundstellung, std::string_view plugs = {}) const -> CompiledKey
+    {
+      CompiledKey key(model, reflector, rotors, ringstellung, grundstellung, plugs);
+      // files of the 3-rotor models have a single placeholder Zusatzwalze slot
+      const std::size_t left = key.rotor_count - 3U;
+      key.cores              = this->cores(reflector, left == 1U ? rotors[0] : RotorId::I, rotors[left], rotors[left + 1U]);
+      if (key.cores != nullptr)
+        key.cores_owner = this->shared_from_this();
+      return key;
+    }
+
+    // The block of a rotor order, [zusatzwalze offset][left offset][middle offset][contact], nullptr when not in the file
+    [[nodiscard]] auto cores(ReflectorId reflector, RotorId zusatzwalze, RotorId left, RotorId middle) const noexcept -> const std::uint8_t *
+    {
+      const std::size_t slot = this->layout.slot(reflector, zusatzwalze, left, middle);
+      if (slot == Layout::npos)
+        return nullptr;
+      return static_cast<const std::uint8_t *>(this->data) + sizeof(detail::TableCacheHeader) + slot * this->layout.block;
+    }
+
+  private:
+    // Order of the blocks in a file: reflector, Zusatzwalze, left rotor, middle rotor (one of the others)
+    struct Layout
+    {
+      static constexpr std::size_t npos = ~std::size_t{};
+
+      explicit Layout(Model model)
+          : model{model},
+            rotors{model == Model::M1 ? 5U : 8U},
+            offsets{model == Model::M4 ? 26U : 1U},
+            block{offsets * 26U * 26U * 26U}
+      {
+        if (model == Model::M4)
+        {
+          this->reflectors   = {ReflectorId::ThinB, ReflectorId::ThinC};
+          this->zusatzwalzen = {RotorId::BETA, RotorId::GAMMA};
+        }
+        else
+        {
+          this->reflectors   = {ReflectorId::A, ReflectorId::B, ReflectorId::C};
+          this->zusatzwalzen = {RotorId::I};
+        }
+      }
+
+      [[nodiscard]] auto size() const noexcept -> std::size_t { return this->reflectors.size() * this->zusatzwalzen.size() * this->rotors * (this->rotors - 1U) * this->block; }
+
+      [[nodiscard]] auto slot(ReflectorId reflector, RotorId zusatzwalze, RotorId left, RotorId middle) const noexcept -> std::size_t
+      {
+        const auto reflector_slot   = std::find(this->reflectors.begin(), this->reflectors.end(), reflector);
+        const auto zusatzwalze_slot = std::find(this->zusatzwalzen.begin(), this->zusatzwalzen.end(), zusatzwalze);
+        if (reflector_slot == this->reflectors.end() || zusatzwalze_slot == this->zusatzwalzen.end() || static_cast<std::size_t>(left) >= this->rotors || static_cast<std::size_t>(middle) >= this->rotors || left == middle)
+          return npos;
+        const auto reflector_index   = static_cast<std::size_t>(reflector_slot - this->reflectors.begin());
+        const auto zusatzwalze_index = static_cast<std::size_t>(zusatzwalze_slot - this->zusatzwalzen.begin());
+        const auto middle_index      = static_cast<std::size_t>(middle) - static_cast<std::size_t>(middle > left);
+        return ((reflector_index * this->zusatzwalzen.size() + zusatzwalze_index) * this->rotors + static_cast<std::size_t>(left)) * (this->rotors - 1U) + middle_index;
+      }
+
+      Model                    model;
+      std::size_t              rotors;
+      std::size_t              offsets;
+      std::size_t              block;
+      std::vector<ReflectorId> reflectors;
+      std::vector<RotorId>     zusatzwalzen;
+    };
+
+    explicit TableCache(const std::string &path) : layout{Model::M1}
+    {
+      const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (file < 0)
+        throw std::system_error(errno, std::generic_category(), "Cannot open table cache " + path);
+      struct stat status{};
+      if (::fstat(file, &status) != 0)
+      {
+        const int error = errno;
+        ::close(file);
+        throw std::system_error(error, std::generic_category(), "Cannot open table cache " + path);
+      }
+      this->length = static_cast<std::size_t>(status.st_size);
+      if (this->length < sizeof(detail::TableCacheHeader))
+      {
+        ::close(file);
+        throw std::invalid_argument("Not an enmach table cache: " + path);
+      }
+      this->data = ::mmap(nullptr, this->length, PROT_READ, MAP_SHARED, file, 0);
+      const int error = errno;
+      ::close(file);
+      if (this->data == MAP_FAILED)
+        throw std::system_error(error, std::generic_category(), "Cannot map table cache " + path);
+
+      try
+      {
+        this->validate(path);
+      }
+      catch (...)
+      {
+        ::munmap(this->data, this->length);
+        throw;
+      }
+    }
+
+    auto validate(const std::string &path) -> void
+    {
+      detail::TableCacheHeader header{};
+      std::memcpy(&header, this->data, sizeof(header));
+      if (header.magic != detail::table_cache_magic)
+        throw std::invalid_argument("Not an enmach table cache: " + path);
+      if (header.version != detail::table_cache_version)
+        throw std::invalid_argument("Unsupported table cache version: " + path);
+      if (header.model > static_cast<std::uint32_t>(Model::M4))
+        throw std::invalid_argument("Corrupted table cache: " + path);
+      this->layout = Layout(static_cast<Model>(header.model));
+      if (header.wiring != detail::wiring_fingerprint(this->layout.model))
+        throw std::invalid_argument("Table cache was generated from other wirings: " + path);
+
+      if (header.size != this->layout.size() || this->length - sizeof(header) != header.size)
+        throw std::invalid_argument("Corrupted table cache: " + path);
+    }
+
+    // Same permutation as CompiledKey::rebuild_core for every offset of the rotors left of the rightmost one
+    static auto fill_block(std::uint8_t *block, const Layout &layout, ReflectorId reflector, RotorId zusatzwalze, RotorId left, RotorId middle) noexcept -> void
+    {
+      const auto &value      = *detail::reflector_wirings[static_cast<std::size_t>(reflector)].value;
+      const auto &zusatz     = detail::rotor_wirings[static_cast<std::size_t>(zusatzwalze)];
+      const auto &left_rotor = detail::rotor_wirings[static_cast<std::size_t>(left)];
+      const auto &mid_rotor  = detail::rotor_wirings[static_cast<std::size_t>(middle)];
+      for (std::uint8_t z{}; z < layout.offsets; ++z)
+        for (std::uint8_t l{}; l < ETW.size(); ++l)
+          for (std::uint8_t m{}; m < ETW.size(); ++m)
+            for (std::uint8_t index{}; index < ETW.size(); ++index)
+            {
+              std::uint8_t contact = (*mid_rotor.forward)[m][index];
+              contact              = (*left_rotor.forward)[l][contact];
+              if (layout.offsets != 1U)
+                contact = (*zusatz.forward)[z][contact];
+              contact = value[contact];
+              if (layout.offsets != 1U)
+                contact = (*zusatz.inverse)[z][contact];
+              contact  = (*left_rotor.inverse)[l][contact];
+              *block++ = (*mid_rotor.inverse)[m][contact];
+            }
+    }
+
+    Layout      layout;
+    void       *data{};
+    std::size_t length{};
+  };
+} // namespace enmach
+
+#endif // ENMACH_TABLECACHE_HPP_
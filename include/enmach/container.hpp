@@ -0,0 +1,301 @@
+#ifndef ENMACH_CONTAINER_HPP_
+#define ENMACH_CONTAINER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "enmach/DynamicEnigma.hpp"
+#include "enmach/Steckerbrett.hpp"
+#include "enmach/common.hpp"
+#include "enmach/input.hpp"
+
+// Seekable ciphertext files. The key sits in a fixed header, followed by the ciphertext in chunks of chunk_size bytes
+// and an index holding the key presses before each chunk. Ciphertext byte N is plaintext byte N, so any range is
+// decrypted by advancing a copy of the key to its first letter, without reading what comes before its chunk.
+//
+//   offset  size  field (little endian)
+//        0     8  magic "ENMACHCT"
+//        8     2  version
+//       10     2  content (0 letters only, 1 non-letters passed through)
+//       12     4  chunk_size
+//       16     8  length of the ciphertext
+//       24     8  offset of the index
+//       32     1  model
+//       33     1  reflector
+//       34     4  rotors, left to right
+//       38     4  ring settings, left to right
+//       42     4  initial positions, left to right
+//       46    26  plugboard, the letter each of a-z is wired to
+//       72     8  reserved
+//       80        ciphertext, then (length + chunk_size - 1) / chunk_size 8 byte key press counts
+namespace enmach::container
+{
+  inline constexpr std::string_view magic         = "ENMACHCT";
+  inline constexpr std::uint16_t    version       = 1U;
+  inline constexpr std::size_t      header_size   = 80U;
+  inline constexpr std::uint32_t    default_chunk = std::uint32_t{1} << 16U;
+
+  enum class Content : std::uint16_t
+  {
+    // anything else is rejected by the writer
+    Letters,
+    // copied unchanged and not stepping the rotors, as input::Passthrough
+    Passthrough
+  };
+
+  // DynamicEnigma settings as stored in the header, rings and positions hold one letter per rotor
+  struct Key
+  {
+    Model                model{Model::M3};
+    ReflectorId          reflector{ReflectorId::B};
+    std::vector<RotorId> rotors;
+    std::string          rings;
+    std::string          positions;
+    std::string          plugs;
+
+    [[nodiscard]] auto machine() const -> DynamicEnigma { return DynamicEnigma(this->model, this->reflector, this->rotors, this->rings, this->positions, this->plugs); }
+  };
+
+  namespace detail
+  {
+    template<class T>
+    auto store(char *bytes, T value) noexcept -> void
+    {
+      for (std::size_t i{}; i < sizeof(T); ++i)
+        bytes[i] = static_cast<char>(static_cast<std::uint8_t>(value >> (8U * i)));
+    }
+
+    template<class T>
+    [[nodiscard]] auto load(const char *bytes) noexcept -> T
+    {
+      std::uint64_t value{};
+      for (std::size_t i{}; i < sizeof(T); ++i)
+        value |= std::uint64_t{static_cast<std::uint8_t>(bytes[i])} << (8U * i);
+      return static_cast<T>(value);
+    }
+
+    inline auto read_exactly(std::istream &stream, std::uint64_t offset, char *data, std::size_t size) -> void
+    {
+      stream.clear();
+      stream.seekg(static_cast<std::streamoff>(offset));
+      if (!stream.read(data, static_cast<std::streamsize>(size)))
+        throw std::invalid_argument("Container is truncated");
+    }
+
+    inline auto write_exactly(std::ostream &stream, const char *data, std::size_t size) -> void
+    {
+      if (!stream.write(data, static_cast<std::streamsize>(size)))
+        throw std::runtime_error("Cannot write container");
+    }
+  } // namespace detail
+
+  // Encrypts text appended in any number of write calls. The container is only complete after finish, which needs a
+  // seekable stream to fill in the header.
+  class Writer
+  {
+  public:
+    Writer(std::ostream &stream, const Key &key, Content content = Content::Letters, std::uint32_t chunk_size = default_chunk)
+        : stream_{stream}, key_{key}, machine_{key.machine()}, content_{content}, chunk_size_{chunk_size}, start_{static_cast<std::uint64_t>(stream.tellp())}
+    {
+      if (chunk_size == 0U)
+        throw std::invalid_argument("Chunk size must not be 0");
+      if (content != Content::Letters && content != Content::Passthrough)
+        throw std::invalid_argument("Unknown container content");
+      if (stream.tellp() < 0)
+        throw std::invalid_argument("Container stream must be seekable");
+      const std::array<char, header_size> placeholder{};
+      detail::write_exactly(this->stream_, placeholder.data(), placeholder.size());
+    }
+
+    // Throws std::invalid_argument on non-letters in a Content::Letters container, before writing anything
+    auto write(std::string_view text) -> void
+    {
+      if (this->content_ == Content::Letters && input::count_letters(text.data(), text.data() + text.size()) != text.size())
+        throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
+
+      while (!text.empty())
+      {
+        const std::uint64_t within = this->length_ % this->chunk_size_;
+        if (within == 0U)
+          this->index_.push_back(this->machine_.position());
+        const std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(text.size(), this->chunk_size_ - within));
+        this->buffer_.resize(size);
+        this->machine_.transform<input::Passthrough>(text.substr(0U, size), this->buffer_.data());
+        detail::write_exactly(this->stream_, this->buffer_.data(), size);
+        this->length_ += size;
+        text.remove_prefix(size);
+      }
+    }
+
+    // Writes the index and the header, the stream is left at the end of the container
+    auto finish() -> void
+    {
+      std::vector<char> index(this->index_.size() * sizeof(std::uint64_t));
+      for (std::size_t chunk{}; chunk < this->index_.size(); ++chunk)
+        detail::store(index.data() + chunk * sizeof(std::uint64_t), this->index_[chunk]);
+      detail::write_exactly(this->stream_, index.data(), index.size());
+      const auto end = this->stream_.tellp();
+
+      std::array<char, header_size> header{};
+      std::copy(magic.begin(), magic.end(), header.begin());
+      detail::store(header.data() + 8U, version);
+      detail::store(header.data() + 10U, static_cast<std::uint16_t>(this->content_));
+      detail::store(header.data() + 12U, this->chunk_size_);
+      detail::store(header.data() + 16U, this->length_);
+      detail::store(header.data() + 24U, header_size + this->length_);
+      header[32U] = static_cast<char>(this->key_.model);
+      header[33U] = static_cast<char>(this->key_.reflector);
+      for (std::size_t rotor{}; rotor < this->key_.rotors.size(); ++rotor)
+      {
+        header[34U + rotor] = static_cast<char>(this->key_.rotors[rotor]);
+        header[38U + rotor] = to_lowercase(this->key_.rings[rotor]);
+        header[42U + rotor] = to_lowercase(this->key_.positions[rotor]);
+      }
+      const Steckerbrett plugboard(this->key_.plugs);
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+        header[46U + letter] = static_cast<char>('a' + plugboard[letter]);
+
+      this->stream_.seekp(static_cast<std::streamoff>(this->start_));
+      detail::write_exactly(this->stream_, header.data(), header.size());
+      this->stream_.seekp(end);
+      if (!this->stream_.flush())
+        throw std::runtime_error("Cannot write container");
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::uint64_t { return this->length_; }
+
+  private:
+    std::ostream              &stream_;
+    Key                        key_;
+    DynamicEnigma              machine_;
+    Content                    content_;
+    std::uint32_t              chunk_size_;
+    std::uint64_t              start_;
+    std::uint64_t              length_{};
+    std::vector<std::uint64_t> index_;
+    std::vector<char>          buffer_;
+  };
+
+  // Decrypts any byte range of a container, reading at most one chunk before the range to count its letters
+  class Reader
+  {
+  public:
+    // Throws std::invalid_argument when the stream does not hold a complete container of a supported version
+    explicit Reader(std::istream &stream) : stream_{stream}, start_{static_cast<std::uint64_t>(stream.tellg())}
+    {
+      if (stream.tellg() < 0)
+        throw std::invalid_argument("Container stream must be seekable");
+      std::array<char, header_size> header{};
+      detail::read_exactly(this->stream_, this->start_, header.data(), header.size());
+      if (std::string_view(header.data(), magic.size()) != magic)
+        throw std::invalid_argument("Not an enmach container");
+      if (detail::load<std::uint16_t>(header.data() + 8U) != version)
+        throw std::invalid_argument("Unsupported container version");
+      this->content_ = static_cast<Content>(detail::load<std::uint16_t>(header.data() + 10U));
+      if (this->content_ != Content::Letters && this->content_ != Content::Passthrough)
+        throw std::invalid_argument("Unknown container content");
+      this->chunk_size_ = detail::load<std::uint32_t>(header.data() + 12U);
+      this->length_     = detail::load<std::uint64_t>(header.data() + 16U);
+      if (this->chunk_size_ == 0U || detail::load<std::uint64_t>(header.data() + 24U) != header_size + this->length_)
+        throw std::invalid_argument("Corrupted container header");
+
+      this->key_.model     = static_cast<Model>(header[32U]);
+      this->key_.reflector = static_cast<ReflectorId>(header[33U]);
+      if (this->key_.model > Model::M4 || this->key_.reflector > ReflectorId::ThinC)
+        throw std::invalid_argument("Corrupted container header");
+      const std::size_t rotors = this->key_.model == Model::M4 ? 4U : 3U;
+      for (std::size_t rotor{}; rotor < rotors; ++rotor)
+      {
+        if (static_cast<std::uint8_t>(header[34U + rotor]) > static_cast<std::uint8_t>(RotorId::GAMMA))
+          throw std::invalid_argument("Corrupted container header");
+        this->key_.rotors.push_back(static_cast<RotorId>(header[34U + rotor]));
+        this->key_.rings += header[38U + rotor];
+        this->key_.positions += header[42U + rotor];
+      }
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+        if (header[46U + letter] > static_cast<char>('a' + letter))
+        {
+          this->key_.plugs += static_cast<char>('a' + letter);
+          this->key_.plugs += header[46U + letter];
+        }
+      this->machine_.emplace(this->key_.machine());
+      if (Steckerbrett(this->key_.plugs).table() != this->plugboard(header))
+        throw std::invalid_argument("Corrupted container header");
+
+      std::vector<char> index(this->chunks() * sizeof(std::uint64_t));
+      detail::read_exactly(this->stream_, this->start_ + header_size + this->length_, index.data(), index.size());
+      this->index_.resize(this->chunks());
+      for (std::size_t chunk{}; chunk < this->index_.size(); ++chunk)
+        this->index_[chunk] = detail::load<std::uint64_t>(index.data() + chunk * sizeof(std::uint64_t));
+    }
+
+    [[nodiscard]] auto key() const noexcept -> const Key & { return this->key_; }
+    [[nodiscard]] auto content() const noexcept -> Content { return this->content_; }
+    [[nodiscard]] auto size() const noexcept -> std::uint64_t { return this->length_; }
+    [[nodiscard]] auto chunkSize() const noexcept -> std::uint32_t { return this->chunk_size_; }
+    [[nodiscard]] auto chunks() const noexcept -> std::uint64_t { return (this->length_ + this->chunk_size_ - 1U) / this->chunk_size_; }
+
+    // Decrypts up to length bytes from offset into output and returns the end of the output, which is shorter than
+    // length only at the end of the container. Throws std::out_of_range when offset is past the end.
+    auto read(std::uint64_t offset, std::size_t length, char *output) -> char *
+    {
+      if (offset > this->length_)
+        throw std::out_of_range("Offset is past the end of the container");
+      length = static_cast<std::size_t>(std::min<std::uint64_t>(length, this->length_ - offset));
+      if (length == 0U)
+        return output;
+
+      const std::uint64_t chunk = offset / this->chunk_size_;
+      // non-letters do not step the rotors, the letters from the chunk start to offset are counted
+      const std::uint64_t first  = this->content_ == Content::Passthrough ? chunk * this->chunk_size_ : offset;
+      const auto          before = static_cast<std::size_t>(offset - first);
+      this->buffer_.resize(before + length);
+      detail::read_exactly(this->stream_, this->start_ + header_size + first, this->buffer_.data(), this->buffer_.size());
+
+      DynamicEnigma machine = *this->machine_;
+      machine.advance(this->index_[chunk] + (this->content_ == Content::Passthrough ? input::count_letters(this->buffer_.data(), this->buffer_.data() + before) : offset - chunk * this->chunk_size_));
+      return machine.transform<input::Passthrough>(std::string_view(this->buffer_.data() + before, length), output);
+    }
+
+    [[nodiscard]] auto read(std::uint64_t offset, std::size_t length) -> std::string
+    {
+      std::string text(static_cast<std::size_t>(std::min<std::uint64_t>(length, this->length_ - std::min(offset, this->length_))), '\0');
+      this->read(offset, length, text.data());
+      return text;
+    }
+
+  private:
+    [[nodiscard]] static auto plugboard(const std::array<char, header_size> &header) -> Steckerbrett::Table
+    {
+      Steckerbrett::Table table{};
+      for (std::uint8_t letter{}; letter < ETW.size(); ++letter)
+      {
+        if (!is_lowercase(header[46U + letter]))
+          throw std::invalid_argument("Corrupted container header");
+        table[letter] = static_cast<std::uint8_t>(header[46U + letter] - 'a');
+      }
+      return table;
+    }
+
+    std::istream                &stream_;
+    std::uint64_t                start_;
+    Key                          key_;
+    Content                      content_{};
+    std::uint32_t                chunk_size_{};
+    std::uint64_t                length_{};
+    std::optional<DynamicEnigma> machine_;
+    std::vector<std::uint64_t>   index_;
+    std::vector<char>            buffer_;
+  };
+} // namespace enmach::container
+
+#endif // ENMACH_CONTAINER_HPP_
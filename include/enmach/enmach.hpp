@@ -1,9 +1,14 @@
 #ifndef ENMACH_ENMACH_HPP_
 #define ENMACH_ENMACH_HPP_
 
+#include "enmach/BatchEnigma.hpp"
+#include "enmach/CompiledKey.hpp"
+#include "enmach/DynamicEnigma.hpp"
 #include "enmach/EnigmaMachine.hpp"
 #include "enmach/Reflector.hpp"
 #include "enmach/Rotor.hpp"
+#include "enmach/Steckerbrett.hpp"
+#include "enmach/parallel.hpp"
 #include "enmach/utils.hpp"
 
 namespace enmach
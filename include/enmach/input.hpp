@@ -0,0 +1,210 @@
+#ifndef ENMACH_INPUT_HPP_
+#define ENMACH_INPUT_HPP_
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "enmach/simd.hpp"
+#include "enmach/utils.hpp"
+
+// Policies deciding what transform does with characters other than a-z/A-Z. Letters are lowercased by the
+// substitution kernels themselves, so no policy touches locale state.
+namespace enmach::input
+{
+  // Throws std::invalid_argument before any rotor moves
+  struct Strict
+  {
+  };
+
+  // Leaves them out of the output, they do not step the rotors
+  struct SkipNonLetters
+  {
+  };
+
+  // Copies them to the output unchanged, they do not step the rotors (spaces, line breaks, group separators)
+  struct Passthrough
+  {
+  };
+
+  // Copies them to the output unchanged, each one still steps the rotors as a key press would (unreadable characters
+  // of an intercepted message, such as the '.' in the test vectors)
+  struct Placeholder
+  {
+  };
+
+  // The caller guarantees letters only, anything else turns into an unspecified letter instead of an error
+  struct Unchecked
+  {
+  };
+
+  template<class Input>
+  inline constexpr bool is_policy = std::is_same_v<Input, Strict> || std::is_same_v<Input, SkipNonLetters> || std::is_same_v<Input, Passthrough> || std::is_same_v<Input, Placeholder> || std::is_same_v<Input, Unchecked>;
+
+  template<class Machine, class = void>
+  struct policy
+  {
+    using type = Strict;
+  };
+
+  template<class Machine>
+  struct policy<Machine, std::void_t<typename Machine::Configuration::Input>>
+  {
+    using type = typename Machine::Configuration::Input;
+  };
+
+  // Input policy transform defaults to on a machine, Strict for machines without one such as DynamicEnigma
+  template<class Machine>
+  using policy_t = typename policy<Machine>::type;
+
+  namespace detail
+  {
+    // mask must not be 0
+    [[nodiscard]] inline auto trailing_zeros(std::uint64_t mask) noexcept -> std::size_t
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<std::size_t>(__builtin_ctzll(mask));
+#else
+      return std::bitset<64>((mask & (~mask + 1U)) - 1U).count();
+#endif
+    }
+
+    // mask must not be 0
+    [[nodiscard]] inline auto trailing_zeros(std::uint32_t mask) noexcept -> std::size_t
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+      return std::bitset<32>((mask & (~mask + 1U)) - 1U).count();
+#endif
+    }
+
+    [[nodiscard]] inline auto population_count(std::uint32_t mask) noexcept -> std::size_t
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<std::size_t>(__builtin_popcount(mask));
+#else
+      return std::bitset<32>(mask).count();
+#endif
+    }
+  } // namespace detail
+
+  // Characters classified per pass of the non-strict policies
+  inline constexpr std::size_t chunk = 4096U;
+
+  // Bit i % 64 of masks[i / 64] is set when first[i] is a letter, masks must hold (last - first + 63) / 64 words.
+  // Returns the number of letters.
+  inline auto letter_masks(const char *first, const char *last, std::uint64_t *masks) noexcept -> std::size_t
+  {
+    const auto        size  = static_cast<std::size_t>(last - first);
+    const simd::Isa   isa   = simd::detected();
+    const std::size_t lanes = simd::lanes(isa);
+    std::fill_n(masks, (size + 63U) / 64U, std::uint64_t{});
+
+    std::size_t i{};
+    if (isa != simd::Isa::Scalar)
+      for (; i + lanes <= size; i += lanes)
+        masks[i / 64U] |= static_cast<std::uint64_t>(simd::letter_mask(isa, first + i)) << (i % 64U);
+    for (; i < size; ++i)
+      masks[i / 64U] |= static_cast<std::uint64_t>(is_letter(first[i])) << (i % 64U);
+
+    std::size_t letters{};
+    for (std::size_t word{}; word < (size + 63U) / 64U; ++word)
+      letters += std::bitset<64>(masks[word]).count();
+    return letters;
+  }
+
+  [[nodiscard]] inline auto count_letters(const char *first, const char *last) noexcept -> std::size_t
+  {
+    const auto        size  = static_cast<std::size_t>(last - first);
+    const simd::Isa   isa   = simd::detected();
+    const std::size_t lanes = simd::lanes(isa);
+
+    std::size_t letters{};
+    std::size_t i{};
+    if (isa != simd::Isa::Scalar)
+      for (; i + lanes <= size; i += lanes)
+        letters += std::bitset<32>(simd::letter_mask(isa, first + i)).count();
+    for (; i < size; ++i)
+      letters += static_cast<std::size_t>(is_letter(first[i]));
+    return letters;
+  }
+
+  // Runs letters(first, last, output), which steps and substitutes a range holding letters only, over [first, last)
+  // as the Input policy prescribes. Returns the end of the output, which only differs from output + (last - first)
+  // for SkipNonLetters. output may alias first.
+  template<class Input, class Letters>
+  auto transform(const char *first, const char *last, char *output, Letters &&letters) -> char *
+  {
+    static_assert(is_policy<Input>, "[ERROR] Input must be one of the enmach::input policies.");
+    const auto size = static_cast<std::size_t>(last - first);
+
+    if constexpr (std::is_same_v<Input, Strict> || std::is_same_v<Input, Unchecked>)
+    {
+      if constexpr (std::is_same_v<Input, Strict>)
+        if (count_letters(first, last) != size)
+          throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
+      letters(first, last, output);
+      return output + size;
+    }
+    else
+    {
+      std::uint64_t masks[chunk / 64U];
+      char          buffer[chunk];
+      for (; first != last; first += std::min(chunk, static_cast<std::size_t>(last - first)))
+      {
+        const std::size_t count = std::min(chunk, static_cast<std::size_t>(last - first));
+        letter_masks(first, first + count, masks);
+        const auto bit = [&masks](std::size_t i) { return ((masks[i / 64U] >> (i % 64U)) & 1U) != 0U; };
+
+        if constexpr (std::is_same_v<Input, Placeholder>)
+        {
+          for (std::size_t i{}; i < count; ++i)
+            buffer[i] = bit(i) ? first[i] : 'a';
+          letters(buffer, buffer + count, buffer);
+          for (std::size_t i{}; i < count; ++i)
+            output[i] = bit(i) ? buffer[i] : first[i];
+          output += count;
+        }
+        else
+        {
+          // letters first, in place when skipping since the output never overtakes the input
+          char *const letters_begin = std::is_same_v<Input, SkipNonLetters> ? output : buffer;
+          char       *compacted     = letters_begin;
+          for (std::size_t word{}; word < (count + 63U) / 64U; ++word)
+          {
+            if (masks[word] == ~std::uint64_t{} && word * 64U + 64U <= count)
+            {
+              std::memmove(compacted, first + word * 64U, 64U);
+              compacted += 64;
+              continue;
+            }
+            for (std::uint64_t mask = masks[word]; mask != 0U; mask &= mask - 1U)
+              *compacted++ = first[word * 64U + detail::trailing_zeros(mask)];
+          }
+          letters(letters_begin, compacted, letters_begin);
+
+          if constexpr (std::is_same_v<Input, SkipNonLetters>)
+            output = compacted;
+          else
+          {
+            if (output != first)
+              std::memmove(output, first, count);
+            const char *substituted = buffer;
+            for (std::size_t word{}; word < (count + 63U) / 64U; ++word)
+              for (std::uint64_t mask = masks[word]; mask != 0U; mask &= mask - 1U)
+                output[word * 64U + detail::trailing_zeros(mask)] = *substituted++;
+            output += count;
+          }
+        }
+      }
+      return output;
+    }
+  }
+} // namespace enmach::input
+
+#endif // ENMACH_INPUT_HPP_
@@ -0,0 +1,214 @@
+#ifndef ENMACH_INSTRUMENTATION_HPP_
+#define ENMACH_INSTRUMENTATION_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "enmach/stepping.hpp"
+
+// Compile time instrumentation policies of EnigmaMachine. A policy with enabled == false is never called, so the
+// machine compiles to the same code as without instrumentation. An enabled policy provides the static hooks
+//   steps(const Steps &)                                 key presses and rotor movements, exec/increment and transform
+//   bulk(std::uint64_t characters, std::uint64_t ns)     one transform call
+//   parallel(std::uint64_t characters, std::uint64_t ns) one parallel_transform call
+namespace enmach::instrumentation
+{
+  struct None
+  {
+    constexpr static bool enabled = false;
+  };
+
+  // Rotor movements of a run of key presses
+  struct Steps
+  {
+    std::uint64_t keypresses{};
+    std::uint64_t middle{};
+    // the middle rotor stepping on its own notch, i.e. on the key press after it moved (the left rotor moves with it)
+    std::uint64_t doubles{};
+    std::uint64_t left{};
+
+    // One key press from before to after, right_turn when the right rotor sat on a notch before it
+    constexpr auto record(const Odometer &before, const Odometer &after, bool right_turn) noexcept -> void
+    {
+      const bool left_moved = before.left != after.left;
+      ++this->keypresses;
+      this->middle += static_cast<std::uint64_t>(before.middle != after.middle);
+      this->doubles += static_cast<std::uint64_t>(left_moved && !right_turn);
+      this->left += static_cast<std::uint64_t>(left_moved);
+    }
+  };
+
+  // Totals since the start of the process, over all threads
+  struct Metrics
+  {
+    std::uint64_t keypresses{};
+    std::uint64_t middle_steps{};
+    std::uint64_t double_steps{};
+    std::uint64_t left_steps{};
+    std::uint64_t bulk_calls{};
+    std::uint64_t bulk_characters{};
+    std::uint64_t bulk_nanoseconds{};
+    std::uint64_t parallel_calls{};
+    std::uint64_t parallel_characters{};
+    std::uint64_t parallel_nanoseconds{};
+  };
+
+  template<class Machine, class = void>
+  struct policy
+  {
+    using type = None;
+  };
+
+  template<class Machine>
+  struct policy<Machine, std::void_t<typename Machine::Configuration::Instrumentation>>
+  {
+    using type = typename Machine::Configuration::Instrumentation;
+  };
+
+  // Instrumentation policy of a machine, None for machines without one such as DynamicEnigma
+  template<class Machine>
+  using policy_t = typename policy<Machine>::type;
+
+  template<class Policy>
+  inline constexpr bool is_policy = std::is_same_v<std::remove_cv_t<decltype(Policy::enabled)>, bool>;
+
+  [[nodiscard]] inline auto now() noexcept -> std::chrono::steady_clock::time_point { return std::chrono::steady_clock::now(); }
+
+  [[nodiscard]] inline auto nanoseconds_since(std::chrono::steady_clock::time_point start) noexcept -> std::uint64_t
+  {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now() - start).count());
+  }
+
+  namespace detail
+  {
+    enum Field : std::size_t
+    {
+      Keypresses,
+      MiddleSteps,
+      DoubleSteps,
+      LeftSteps,
+      BulkCalls,
+      BulkCharacters,
+      BulkNanoseconds,
+      ParallelCalls,
+      ParallelCharacters,
+      ParallelNanoseconds,
+      Fields
+    };
+
+    // Written by its own thread only: relaxed loads and stores compile to plain moves, no locked read-modify-write,
+    // and still let snapshot() read them from another thread.
+    struct ThreadCounters
+    {
+      std::array<std::atomic<std::uint64_t>, Fields> values{};
+
+      auto add(Field field, std::uint64_t count) noexcept -> void { this->values[field].store(this->values[field].load(std::memory_order_relaxed) + count, std::memory_order_relaxed); }
+    };
+
+    struct Registry
+    {
+      std::mutex                          mutex;
+      std::vector<const ThreadCounters *> threads;
+      std::array<std::uint64_t, Fields>   retired{};
+    };
+
+    inline auto registry() -> Registry &
+    {
+      static Registry registry;
+      return registry;
+    }
+
+    // Registered on the first hook a thread calls, folded into the retired totals when the thread exits
+    struct ThreadSlot
+    {
+      ThreadCounters counters;
+
+      ThreadSlot()
+      {
+        Registry                         &registry = detail::registry();
+        const std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.threads.push_back(&this->counters);
+      }
+
+      ThreadSlot(const ThreadSlot &)                     = delete;
+      auto operator=(const ThreadSlot &) -> ThreadSlot & = delete;
+
+      ~ThreadSlot()
+      {
+        Registry                         &registry = detail::registry();
+        const std::lock_guard<std::mutex> lock(registry.mutex);
+        for (std::size_t field{}; field < Fields; ++field)
+          registry.retired[field] += this->counters.values[field].load(std::memory_order_relaxed);
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &this->counters));
+      }
+    };
+
+    inline auto register_thread() -> ThreadCounters &
+    {
+      thread_local ThreadSlot slot;
+      return slot.counters;
+    }
+
+    // The pointer is constant initialized, so the hot path reads it without going through a TLS init guard
+    inline auto local() -> ThreadCounters &
+    {
+      thread_local ThreadCounters *counters = nullptr;
+      if (counters == nullptr)
+        counters = &register_thread();
+      return *counters;
+    }
+  } // namespace detail
+
+  // Per thread counters, aggregated by snapshot()
+  struct Counting
+  {
+    constexpr static bool enabled = true;
+
+    static auto steps(const Steps &steps) -> void
+    {
+      detail::ThreadCounters &counters = detail::local();
+      counters.add(detail::Keypresses, steps.keypresses);
+      counters.add(detail::MiddleSteps, steps.middle);
+      counters.add(detail::DoubleSteps, steps.doubles);
+      counters.add(detail::LeftSteps, steps.left);
+    }
+
+    static auto bulk(std::uint64_t characters, std::uint64_t nanoseconds) -> void
+    {
+      detail::ThreadCounters &counters = detail::local();
+      counters.add(detail::BulkCalls, 1U);
+      counters.add(detail::BulkCharacters, characters);
+      counters.add(detail::BulkNanoseconds, nanoseconds);
+    }
+
+    static auto parallel(std::uint64_t characters, std::uint64_t nanoseconds) -> void
+    {
+      detail::ThreadCounters &counters = detail::local();
+      counters.add(detail::ParallelCalls, 1U);
+      counters.add(detail::ParallelCharacters, characters);
+      counters.add(detail::ParallelNanoseconds, nanoseconds);
+    }
+
+    // Counts of the calls each thread finished so far
+    [[nodiscard]] static auto snapshot() -> Metrics
+    {
+      detail::Registry                         &registry = detail::registry();
+      const std::lock_guard<std::mutex>         lock(registry.mutex);
+      std::array<std::uint64_t, detail::Fields> totals = registry.retired;
+      for (const detail::ThreadCounters *counters : registry.threads)
+        for (std::size_t field{}; field < detail::Fields; ++field)
+          totals[field] += counters->values[field].load(std::memory_order_relaxed);
+      return {totals[detail::Keypresses],    totals[detail::MiddleSteps],     totals[detail::DoubleSteps],     totals[detail::LeftSteps],          totals[detail::BulkCalls],
+              totals[detail::BulkCharacters], totals[detail::BulkNanoseconds], totals[detail::ParallelCalls], totals[detail::ParallelCharacters], totals[detail::ParallelNanoseconds]};
+    }
+  };
+} // namespace enmach::instrumentation
+
+#endif // ENMACH_INSTRUMENTATION_HPP_
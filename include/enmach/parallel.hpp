@@ -0,0 +1,184 @@
+#ifndef ENMACH_PARALLEL_HPP_
+#define ENMACH_PARALLEL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "enmach/input.hpp"
+#include "enmach/instrumentation.hpp"
+
+namespace enmach
+{
+  // Below this many letters per worker spawning a thread costs more than it saves
+  inline constexpr std::size_t parallel_min_chunk = std::size_t{1} << 16U;
+
+  namespace detail
+  {
+    template<class Input, class Machine>
+    auto parallel_transform(Machine &machine, std::string_view text, char *output, std::size_t threads) -> char *
+    {
+      static_assert(input::is_policy<Input>, "[ERROR] Input must be one of the enmach::input policies.");
+      // letters only from here on, the workers skip the check
+      using Worker = std::conditional_t<std::is_same_v<Input, input::Strict>, input::Unchecked, Input>;
+      if constexpr (std::is_same_v<Input, input::Strict>)
+        if (input::count_letters(text.data(), text.data() + text.size()) != text.size())
+          throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
+
+      threads = std::max<std::size_t>(1U, std::min(threads, text.size() / parallel_min_chunk));
+      if (threads == 1U)
+        return machine.template transform<Worker>(text, output);
+
+      // Key presses before each chunk, which is also where its output starts unless non-letters are skipped
+      constexpr bool           letters_step = std::is_same_v<Worker, input::Unchecked> || std::is_same_v<Worker, input::Placeholder>;
+      const std::size_t        chunk        = (text.size() + threads - 1U) / threads;
+      std::vector<std::size_t> presses(threads + 1U);
+      for (std::size_t worker{}; worker < threads; ++worker)
+      {
+        const std::size_t begin = std::min(text.size(), worker * chunk);
+        const std::size_t end   = std::min(text.size(), begin + chunk);
+        presses[worker + 1U]    = presses[worker] + (letters_step ? end - begin : input::count_letters(text.data() + begin, text.data() + end));
+      }
+
+      std::vector<std::thread> workers;
+      workers.reserve(threads - 1U);
+      auto run = [&machine, &presses, text, output, chunk](std::size_t worker) {
+        const std::size_t begin = worker * chunk;
+        Machine           copy  = machine;
+        copy.advance(presses[worker]);
+        copy.template transform<Worker>(text.substr(begin, chunk), output + (std::is_same_v<Worker, input::SkipNonLetters> ? presses[worker] : begin));
+      };
+
+      try
+      {
+        for (std::size_t worker = 1U; worker < threads && worker * chunk < text.size(); ++worker)
+          workers.emplace_back(run, worker);
+      }
+      catch (...)
+      {
+        for (auto &worker : workers)
+          worker.join();
+        throw;
+      }
+      run(0U);
+      for (auto &worker : workers)
+        worker.join();
+
+      machine.advance(presses[threads]);
+      return output + (std::is_same_v<Worker, input::SkipNonLetters> ? presses[threads] : text.size());
+    }
+
+    // run(worker) on threads - 1 new threads and on the calling one, returns once all are done
+    template<class Run>
+    auto run_workers(std::size_t threads, const Run &run) -> void
+    {
+      std::vector<std::thread> workers;
+      workers.reserve(threads - 1U);
+      try
+      {
+        for (std::size_t worker = 1U; worker < threads; ++worker)
+          workers.emplace_back(run, worker);
+      }
+      catch (...)
+      {
+        for (auto &worker : workers)
+          worker.join();
+        throw;
+      }
+      run(0U);
+      for (auto &worker : workers)
+        worker.join();
+    }
+
+    // Work items split into one contiguous range per worker. A worker takes items from the front of its own range
+    // and, once it runs dry, steals the back half of another worker's range.
+    class WorkRanges
+    {
+    public:
+      WorkRanges(std::size_t items, std::size_t workers) : ranges{std::make_unique<Range[]>(workers)}, count{workers}
+      {
+        for (std::size_t worker{}; worker < workers; ++worker)
+        {
+          this->ranges[worker].begin = items * worker / workers;
+          this->ranges[worker].end   = items * (worker + 1U) / workers;
+        }
+      }
+
+      [[nodiscard]] auto next(std::size_t worker) -> std::optional<std::size_t>
+      {
+        {
+          Range                  &own = this->ranges[worker];
+          const std::lock_guard lock{own.mutex};
+          if (own.begin != own.end)
+            return own.begin++;
+        }
+        for (std::size_t distance = 1U; distance < this->count; ++distance)
+        {
+          Range      &victim = this->ranges[(worker + distance) % this->count];
+          std::size_t begin{};
+          std::size_t end{};
+          {
+            const std::lock_guard lock{victim.mutex};
+            if (victim.begin == victim.end)
+              continue;
+            end        = victim.end;
+            begin      = end - (end - victim.begin + 1U) / 2U;
+            victim.end = begin;
+          }
+          Range                  &own = this->ranges[worker];
+          const std::lock_guard lock{own.mutex};
+          own.begin = begin + 1U;
+          own.end   = end;
+          return begin;
+        }
+        return std::nullopt;
+      }
+
+    private:
+      struct alignas(64) Range
+      {
+        std::mutex  mutex;
+        std::size_t begin{};
+        std::size_t end{};
+      };
+
+      std::unique_ptr<Range[]> ranges;
+      std::size_t              count;
+    };
+  } // namespace detail
+
+  // Splits text into one chunk per worker, each worker transforms its chunk with its own copy of machine advanced to
+  // the chunk start. The output, its end and the final state of machine are identical to
+  // machine.transform<Input>(text, output), output must not alias text.
+  template<class Input, class Machine>
+  auto parallel_transform(Machine &machine, std::string_view text, char *output, std::size_t threads = std::thread::hardware_concurrency()) -> char *
+  {
+    using Instrumentation = instrumentation::policy_t<Machine>;
+    if constexpr (Instrumentation::enabled)
+    {
+      const auto start = instrumentation::now();
+      char      *end   = detail::parallel_transform<Input>(machine, text, output, threads);
+      Instrumentation::parallel(static_cast<std::uint64_t>(text.size()), instrumentation::nanoseconds_since(start));
+      return end;
+    }
+    else
+      return detail::parallel_transform<Input>(machine, text, output, threads);
+  }
+
+  // Same with the input policy of the machine configuration, as machine.transform(text, output)
+  template<class Machine>
+  auto parallel_transform(Machine &machine, std::string_view text, char *output, std::size_t threads = std::thread::hardware_concurrency()) -> char *
+  {
+    return parallel_transform<input::policy_t<Machine>>(machine, text, output, threads);
+  }
+} // namespace enmach
+
+#endif // ENMACH_PARALLEL_HPP_
@@ -0,0 +1,245 @@
+#ifndef ENMACH_SIMD_HPP_
+#define ENMACH_SIMD_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ENMACH_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define ENMACH_SIMD_X86 0
+#endif
+
+namespace enmach::simd
+{
+  enum class Isa : std::uint8_t
+  {
+    Scalar,
+    SSSE3,
+    AVX2
+  };
+
+  [[nodiscard]] constexpr auto lanes(Isa isa) noexcept -> std::size_t
+  {
+    switch (isa)
+    {
+      case Isa::AVX2: return 32U;
+      case Isa::SSSE3: return 16U;
+      default: return 1U;
+    }
+  }
+
+  [[nodiscard]] inline auto detected() noexcept -> Isa
+  {
+#if ENMACH_SIMD_X86
+    static const Isa isa = [] {
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+        return Isa::AVX2;
+      if (__builtin_cpu_supports("ssse3"))
+        return Isa::SSSE3;
+      return Isa::Scalar;
+    }();
+    return isa;
+#else
+    return Isa::Scalar;
+#endif
+  }
+
+  // 26-entry permutations padded to 32 bytes so that both 16-byte halves can be loaded.
+  // Rotors are stored left to right, the signal goes through forward from the last one to the first.
+  struct Tables
+  {
+    alignas(32) std::uint8_t plugboard[32]{};
+    alignas(32) std::uint8_t reflector[32]{};
+    alignas(32) std::uint8_t forward[4][32]{};
+    alignas(32) std::uint8_t inverse[4][32]{};
+    std::size_t rotors{};
+  };
+
+  // Per-lane effective offset of every rotor for a block of consecutive key presses
+  struct Offsets
+  {
+    alignas(32) std::uint8_t value[4][32]{};
+  };
+
+  // 0xff at every effective offset where the middle or right rotor sits on a turnover notch, 0 elsewhere
+  struct NotchTables
+  {
+    alignas(32) std::uint8_t middle[32]{};
+    alignas(32) std::uint8_t right[32]{};
+  };
+
+#if ENMACH_SIMD_X86
+  namespace detail
+  {
+    // Each permutation is split in two 16-byte halves: indices 0-15 hit the low half (+0x70 saturates everything
+    // above 15 into the zeroing range of pshufb), indices 16-25 hit the high half (-16 wraps everything below 16).
+    __attribute__((target("ssse3"))) inline auto lookup(__m128i low, __m128i high, __m128i index) noexcept -> __m128i
+    {
+      return _mm_or_si128(_mm_shuffle_epi8(low, _mm_adds_epu8(index, _mm_set1_epi8(0x70))), _mm_shuffle_epi8(high, _mm_sub_epi8(index, _mm_set1_epi8(16))));
+    }
+
+    // (a + b) % 26 and (a - b) % 26 for a, b in [0, 26)
+    __attribute__((target("ssse3"))) inline auto add26(__m128i a, __m128i b) noexcept -> __m128i
+    {
+      const __m128i sum = _mm_add_epi8(a, b);
+      return _mm_min_epu8(sum, _mm_sub_epi8(sum, _mm_set1_epi8(26)));
+    }
+
+    __attribute__((target("ssse3"))) inline auto sub26(__m128i a, __m128i b) noexcept -> __m128i { return add26(a, _mm_sub_epi8(_mm_set1_epi8(26), b)); }
+
+    __attribute__((target("ssse3"))) inline auto load(const std::uint8_t *table) noexcept -> __m128i { return _mm_load_si128(reinterpret_cast<const __m128i *>(table)); }
+
+    __attribute__((target("avx2"))) inline auto lookup(__m256i low, __m256i high, __m256i index) noexcept -> __m256i
+    {
+      return _mm256_or_si256(_mm256_shuffle_epi8(low, _mm256_adds_epu8(index, _mm256_set1_epi8(0x70))), _mm256_shuffle_epi8(high, _mm256_sub_epi8(index, _mm256_set1_epi8(16))));
+    }
+
+    __attribute__((target("avx2"))) inline auto add26(__m256i a, __m256i b) noexcept -> __m256i
+    {
+      const __m256i sum = _mm256_add_epi8(a, b);
+      return _mm256_min_epu8(sum, _mm256_sub_epi8(sum, _mm256_set1_epi8(26)));
+    }
+
+    __attribute__((target("avx2"))) inline auto sub26(__m256i a, __m256i b) noexcept -> __m256i { return add26(a, _mm256_sub_epi8(_mm256_set1_epi8(26), b)); }
+
+    // Both 128-bit lanes hold the same half, vpshufb does not cross lanes
+    __attribute__((target("avx2"))) inline auto broadcast(const std::uint8_t *table) noexcept -> __m256i { return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(table))); }
+  } // namespace detail
+
+  // Substitutes 16 letters (a-z or A-Z) at once
+  __attribute__((target("ssse3"))) inline auto substitute_ssse3(const Tables &tables, const Offsets &offsets, const char *input, char *output) noexcept -> void
+  {
+    using namespace detail;
+    __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+    index         = _mm_sub_epi8(_mm_or_si128(index, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+
+    index = lookup(load(tables.plugboard), load(tables.plugboard + 16), index);
+    for (std::size_t rotor = tables.rotors; rotor-- > 0U;)
+    {
+      const __m128i offset = load(offsets.value[rotor]);
+      index                = sub26(lookup(load(tables.forward[rotor]), load(tables.forward[rotor] + 16), add26(index, offset)), offset);
+    }
+    index = lookup(load(tables.reflector), load(tables.reflector + 16), index);
+    for (std::size_t rotor = 0U; rotor < tables.rotors; ++rotor)
+    {
+      const __m128i offset = load(offsets.value[rotor]);
+      index                = sub26(lookup(load(tables.inverse[rotor]), load(tables.inverse[rotor] + 16), add26(index, offset)), offset);
+    }
+    index = lookup(load(tables.plugboard), load(tables.plugboard + 16), index);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm_add_epi8(index, _mm_set1_epi8('a')));
+  }
+
+  // Substitutes 32 letters (a-z or A-Z) at once
+  __attribute__((target("avx2"))) inline auto substitute_avx2(const Tables &tables, const Offsets &offsets, const char *input, char *output) noexcept -> void
+  {
+    using namespace detail;
+    __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+    index         = _mm256_sub_epi8(_mm256_or_si256(index, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+
+    const __m256i plugboard_low  = broadcast(tables.plugboard);
+    const __m256i plugboard_high = broadcast(tables.plugboard + 16);
+    index                        = lookup(plugboard_low, plugboard_high, index);
+    for (std::size_t rotor = tables.rotors; rotor-- > 0U;)
+    {
+      const __m256i offset = _mm256_load_si256(reinterpret_cast<const __m256i *>(offsets.value[rotor]));
+      index                = sub26(lookup(broadcast(tables.forward[rotor]), broadcast(tables.forward[rotor] + 16), add26(index, offset)), offset);
+    }
+    index = lookup(broadcast(tables.reflector), broadcast(tables.reflector + 16), index);
+    for (std::size_t rotor = 0U; rotor < tables.rotors; ++rotor)
+    {
+      const __m256i offset = _mm256_load_si256(reinterpret_cast<const __m256i *>(offsets.value[rotor]));
+      index                = sub26(lookup(broadcast(tables.inverse[rotor]), broadcast(tables.inverse[rotor] + 16), add26(index, offset)), offset);
+    }
+    index = lookup(plugboard_low, plugboard_high, index);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output), _mm256_add_epi8(index, _mm256_set1_epi8('a')));
+  }
+
+  // One key press in every lane, the left, middle and right rotors are offsets.value[left], [left + 1] and [left + 2]
+  __attribute__((target("ssse3"))) inline auto step_ssse3(const NotchTables &notches, Offsets &offsets, std::size_t left) noexcept -> void
+  {
+    using namespace detail;
+    const __m128i one         = _mm_set1_epi8(1);
+    const __m128i l           = load(offsets.value[left]);
+    const __m128i m           = load(offsets.value[left + 1U]);
+    const __m128i r           = load(offsets.value[left + 2U]);
+    const __m128i right_turn  = lookup(load(notches.right), load(notches.right + 16), r);
+    const __m128i middle_turn = lookup(load(notches.middle), load(notches.middle + 16), m);
+    _mm_store_si128(reinterpret_cast<__m128i *>(offsets.value[left + 2U]), add26(r, one));
+    _mm_store_si128(reinterpret_cast<__m128i *>(offsets.value[left + 1U]), add26(m, _mm_and_si128(_mm_or_si128(right_turn, middle_turn), one)));
+    _mm_store_si128(reinterpret_cast<__m128i *>(offsets.value[left]), add26(l, _mm_and_si128(middle_turn, one)));
+  }
+
+  // Same for 32 lanes
+  __attribute__((target("avx2"))) inline auto step_avx2(const NotchTables &notches, Offsets &offsets, std::size_t left) noexcept -> void
+  {
+    using namespace detail;
+    const __m256i one         = _mm256_set1_epi8(1);
+    const __m256i l           = _mm256_load_si256(reinterpret_cast<const __m256i *>(offsets.value[left]));
+    const __m256i m           = _mm256_load_si256(reinterpret_cast<const __m256i *>(offsets.value[left + 1U]));
+    const __m256i r           = _mm256_load_si256(reinterpret_cast<const __m256i *>(offsets.value[left + 2U]));
+    const __m256i right_turn  = lookup(broadcast(notches.right), broadcast(notches.right + 16), r);
+    const __m256i middle_turn = lookup(broadcast(notches.middle), broadcast(notches.middle + 16), m);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(offsets.value[left + 2U]), add26(r, one));
+    _mm256_store_si256(reinterpret_cast<__m256i *>(offsets.value[left + 1U]), add26(m, _mm256_and_si256(_mm256_or_si256(right_turn, middle_turn), one)));
+    _mm256_store_si256(reinterpret_cast<__m256i *>(offsets.value[left]), add26(l, _mm256_and_si256(middle_turn, one)));
+  }
+
+  // Bit i is set when input[i] is a letter (a-z or A-Z), for 16 characters
+  __attribute__((target("ssse3"))) inline auto letter_mask_ssse3(const char *input) noexcept -> std::uint32_t
+  {
+    const __m128i index = _mm_sub_epi8(_mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input)), _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(index, _mm_set1_epi8(25)), index)));
+  }
+
+  // Same for 32 characters
+  __attribute__((target("avx2"))) inline auto letter_mask_avx2(const char *input) noexcept -> std::uint32_t
+  {
+    const __m256i index = _mm256_sub_epi8(_mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(input)), _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(index, _mm256_set1_epi8(25)), index)));
+  }
+#endif
+
+  // Bit i is set when input[i] is a letter, for lanes(isa) characters, isa must not be Isa::Scalar
+  inline auto letter_mask(Isa isa, const char *input) noexcept -> std::uint32_t
+  {
+#if ENMACH_SIMD_X86
+    return isa == Isa::AVX2 ? letter_mask_avx2(input) : letter_mask_ssse3(input);
+#else
+    (void)isa, (void)input;
+    return 0U;
+#endif
+  }
+
+  // One key press in each of lanes(isa) independent machines, isa must not be Isa::Scalar
+  inline auto step(Isa isa, const NotchTables &notches, Offsets &offsets, std::size_t left) noexcept -> void
+  {
+#if ENMACH_SIMD_X86
+    if (isa == Isa::AVX2)
+      step_avx2(notches, offsets, left);
+    else
+      step_ssse3(notches, offsets, left);
+#else
+    (void)isa, (void)notches, (void)offsets, (void)left;
+#endif
+  }
+
+  // Substitutes lanes(isa) letters, isa must not be Isa::Scalar
+  inline auto substitute(Isa isa, const Tables &tables, const Offsets &offsets, const char *input, char *output) noexcept -> void
+  {
+#if ENMACH_SIMD_X86
+    if (isa == Isa::AVX2)
+      substitute_avx2(tables, offsets, input, output);
+    else
+      substitute_ssse3(tables, offsets, input, output);
+#else
+    (void)isa, (void)tables, (void)offsets, (void)input, (void)output;
+#endif
+  }
+} // namespace enmach::simd
+
+#endif // ENMACH_SIMD_HPP_
@@ -0,0 +1,113 @@
+#ifndef ENMACH_STEPPING_HPP_
+#define ENMACH_STEPPING_HPP_
+
+#include <cstdint>
+
+#include "enmach/common.hpp"
+
+namespace enmach
+{
+  // Effective offsets of the three stepping rotors (left, middle, right)
+  struct Odometer
+  {
+    std::uint8_t left{};
+    std::uint8_t middle{};
+    std::uint8_t right{};
+  };
+
+  // Bit i is set when the rotor sits on a turnover notch at effective offset i
+  struct Notches
+  {
+    std::uint32_t middle{};
+    std::uint32_t right{};
+  };
+
+  [[nodiscard]] constexpr auto operator==(const Odometer &lhs, const Odometer &rhs) noexcept -> bool { return lhs.left == rhs.left && lhs.middle == rhs.middle && lhs.right == rhs.right; }
+
+  [[nodiscard]] constexpr auto operator!=(const Odometer &lhs, const Odometer &rhs) noexcept -> bool { return !(lhs == rhs); }
+
+  [[nodiscard]] constexpr auto operator==(const Notches &lhs, const Notches &rhs) noexcept -> bool { return lhs.middle == rhs.middle && lhs.right == rhs.right; }
+
+  [[nodiscard]] constexpr auto operator!=(const Notches &lhs, const Notches &rhs) noexcept -> bool { return !(lhs == rhs); }
+
+  [[nodiscard]] constexpr auto at_notch(std::uint32_t notches, std::uint8_t offset) noexcept -> bool { return ((notches >> offset) & 1U) != 0U; }
+
+  [[nodiscard]] constexpr auto count_notches(std::uint32_t notches) noexcept -> std::uint8_t
+  {
+    std::uint8_t count{};
+    for (; notches != 0U; notches &= notches - 1U)
+      ++count;
+    return count;
+  }
+
+  [[nodiscard]] constexpr auto wrap(std::uint64_t offset) noexcept -> std::uint8_t { return static_cast<std::uint8_t>(offset % ETW.size()); }
+
+  // Number of notches met by a rotor visiting offsets from, from + 1, ..., from + count - 1
+  [[nodiscard]] constexpr auto count_notches(std::uint32_t notches, std::uint8_t from, std::uint64_t count) noexcept -> std::uint64_t
+  {
+    std::uint64_t result = (count / ETW.size()) * count_notches(notches);
+    for (std::uint64_t remaining = count % ETW.size(); remaining != 0U; --remaining, from = wrap(from + 1U))
+      result += static_cast<std::uint64_t>(at_notch(notches, from));
+    return result;
+  }
+
+  // offset + (should_step ? 1 : 0) without a division
+  [[nodiscard]] constexpr auto step_offset(std::uint8_t offset, bool should_step) noexcept -> std::uint8_t
+  {
+    offset = static_cast<std::uint8_t>(offset + static_cast<std::uint8_t>(should_step));
+    return static_cast<std::uint8_t>(offset - static_cast<std::uint8_t>(offset == ETW.size()) * ETW.size());
+  }
+
+  // One key press, same rules as EnigmaMachine::increment: the right rotor always steps, the middle rotor steps when
+  // the right rotor or itself sits on a notch (double step), the left rotor steps when the middle rotor sits on a notch.
+  constexpr auto step(Odometer &odometer, const Notches &notches) noexcept -> void
+  {
+    const bool right_turn  = at_notch(notches.right, odometer.right);
+    const bool middle_turn = at_notch(notches.middle, odometer.middle);
+    odometer.right         = step_offset(odometer.right, true);
+    odometer.middle        = step_offset(odometer.middle, right_turn || middle_turn);
+    odometer.left          = step_offset(odometer.left, middle_turn);
+  }
+
+  // count key presses in constant time.
+  // The middle rotor moves once per right notch and once more (taking the left rotor along) on the key press after it
+  // lands on one of its own notches. Away from a notch, it therefore completes a revolution every 26 - notches right
+  // notches, so whole revolutions only move the left rotor and at most one revolution is replayed notch by notch.
+  constexpr auto advance(Odometer &odometer, const Notches &notches, std::uint64_t count) noexcept -> void
+  {
+    if (count == 0U)
+      return;
+
+    std::uint64_t events     = count_notches(notches.right, odometer.right, count);
+    const bool    last_event = at_notch(notches.right, wrap(odometer.right + count - 1U));
+    const bool    first_turn = at_notch(notches.right, odometer.right);
+    const auto    left_turns = count_notches(notches.middle);
+    odometer.right           = wrap(odometer.right + count);
+
+    // middle rotor starts on a notch: double step on the first key press, absorbing a right notch there
+    if (at_notch(notches.middle, odometer.middle))
+    {
+      odometer.middle = wrap(odometer.middle + 1U);
+      odometer.left   = wrap(odometer.left + 1U);
+      events -= static_cast<std::uint64_t>(first_turn);
+    }
+    if (events == 0U)
+      return;
+
+    const std::uint64_t period      = ETW.size() - left_turns;
+    const std::uint64_t revolutions = (events - 1U) / period;
+    odometer.left                   = wrap(odometer.left + revolutions * left_turns);
+    for (std::uint64_t remaining = events - revolutions * period; remaining != 0U; --remaining)
+    {
+      odometer.middle = wrap(odometer.middle + 1U);
+      // the double step of the last right notch may fall past the last key press
+      if (at_notch(notches.middle, odometer.middle) && !(remaining == 1U && last_event))
+      {
+        odometer.middle = wrap(odometer.middle + 1U);
+        odometer.left   = wrap(odometer.left + 1U);
+      }
+    }
+  }
+} // namespace enmach
+
+#endif // ENMACH_STEPPING_HPP_
@@ -1,7 +1,8 @@
 #ifndef ENMACH_UTILS_HPP_
 #define ENMACH_UTILS_HPP_
 
-#include <cctype>
+#include <algorithm>
+#include <cstdint>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -28,14 +29,21 @@ namespace enmach
 
   // clang-format off
   constexpr auto is_lowercase   = [](char character) noexcept { return character >= 'a' && character <= 'z'; };
+  constexpr auto is_uppercase   = [](char character) noexcept { return character >= 'A' && character <= 'Z'; };
+  constexpr auto is_letter      = [](char character) noexcept { return is_lowercase(character) || is_uppercase(character); };
   // clang-format on
 
+  // Only meaningful for characters that already satisfy is_letter
+  [[nodiscard]] constexpr auto to_lowercase(char letter) noexcept -> char { return static_cast<char>(letter | 0x20); }
+
+  // Wiring index of a letter, anything else maps to an unspecified index that is still in range
+  [[nodiscard]] constexpr auto to_index(char letter) noexcept -> std::uint8_t { return std::min(static_cast<std::uint8_t>(to_lowercase(letter) - 'a'), std::uint8_t{25}); }
+
   [[nodiscard]] constexpr auto to_lowercase_or_die(char letter) -> char
   {
-    letter = static_cast<char>(std::tolower(letter));
-    if (!is_lowercase(letter)) 
+    if (!is_letter(letter))
       throw std::invalid_argument("Character must be a lowercase letter (a-z) or uppercase letter (A-Z)");
-    return letter;
+    return to_lowercase(letter);
   }
 
 } // namespace enmach
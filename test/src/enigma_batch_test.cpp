@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "enmach/enmach.hpp"
+#include "test_input.hpp"
+
+using namespace enmach;
+using test_input::make_input;
+
+namespace
+{
+  // Ragged lengths from empty to a few hundred letters, each with its own initial position
+  auto expect_matches_dynamic(Model model, ReflectorId reflector, const std::vector<RotorId> &rotors, const std::string &rings, simd::Isa isa) -> void
+  {
+    const std::string        plugs = "AV BS CG DL FU HZ IN KM OW RX";
+    const BatchEnigma        batch(model, reflector, rotors, rings, plugs);
+    std::vector<std::string> texts;
+    std::vector<std::string> positions;
+    std::vector<std::string> outputs;
+    for (std::size_t message{}; message < 101U; ++message)
+    {
+      texts.push_back(make_input(message * 37U % 300U, message, true));
+      std::string position;
+      for (std::size_t rotor{}; rotor < rings.size(); ++rotor)
+        position += static_cast<char>('a' + (message * (rotor + 5U) + rotor) % 26U);
+      positions.push_back(position);
+      outputs.emplace_back(texts.back().size(), '\0');
+    }
+    std::vector<BatchEnigma::Message> messages;
+    for (std::size_t message{}; message < texts.size(); ++message)
+      messages.push_back({texts[message], positions[message], outputs[message].data()});
+    batch.transform(messages, isa);
+
+    for (std::size_t message{}; message < texts.size(); ++message)
+    {
+      DynamicEnigma machine(model, reflector, rotors, rings, positions[message], plugs);
+      std::string   expected(texts[message].size(), '\0');
+      machine.transform(texts[message], expected.data());
+      ASSERT_EQ(outputs[message], expected) << "message " << message << " isa " << static_cast<int>(isa);
+    }
+  }
+} // namespace
+
+TEST(EnigmaBatchTests, matches_dynamic)
+{
+  for (const auto isa : {simd::Isa::Scalar, simd::Isa::SSSE3, simd::Isa::AVX2})
+  {
+    expect_matches_dynamic(Model::M1, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "aaa", isa);
+    // double notch rotors and ring settings
+    expect_matches_dynamic(Model::M3, ReflectorId::C, {RotorId::VI, RotorId::VII, RotorId::VIII}, "hlk", isa);
+    expect_matches_dynamic(Model::M4, ReflectorId::ThinC, {RotorId::BETA, RotorId::V, RotorId::VI, RotorId::VIII}, "aael", isa);
+  }
+}
+
+TEST(EnigmaBatchTests, errors)
+{
+  ASSERT_THROW(BatchEnigma(Model::M3, ReflectorId::ThinB, {RotorId::I, RotorId::II, RotorId::III}, "aaa"), std::invalid_argument);
+  ASSERT_THROW(BatchEnigma(Model::M3, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "aa"), std::invalid_argument);
+
+  const BatchEnigma batch(Model::M3, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "aaa");
+  std::string       first(5U, '-');
+  std::string       second(5U, '-');
+  ASSERT_THROW(batch.transform({{"hello", "aaa", first.data()}, {"wor d", "aaa", second.data()}}), std::invalid_argument);
+  ASSERT_THROW(batch.transform({{"hello", "aa", first.data()}}), std::invalid_argument);
+  ASSERT_EQ(first, "-----");
+  batch.transform({});
+}
@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "enmach/Bombe.hpp"
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+
+namespace
+{
+  const std::string plaintext = "wettervorhersagebiskayaxxnordwestwindstaerkefuenfregenschauer";
+
+  auto encrypt(Model model, ReflectorId reflector, const std::vector<RotorId> &rotors, const std::string &positions, const std::string &plugs) -> std::string
+  {
+    DynamicEnigma machine(model, reflector, rotors, std::string(rotors.size(), 'a'), positions, plugs);
+    std::string   output(plaintext.size(), '\0');
+    machine.transform(plaintext, output.data());
+    return output;
+  }
+
+  // Every implied pair is a pair of the key
+  auto implied_by(const std::string &implied, const std::string &plugs) -> bool
+  {
+    const Steckerbrett board(plugs);
+    for (std::size_t pair{}; pair + 1U < implied.size(); pair += 3U)
+      if (board(implied[pair]) != implied[pair + 1U] - 'A' + 'a')
+        return false;
+    return true;
+  }
+} // namespace
+
+TEST(EnigmaBombeTests, menu)
+{
+  const Menu menu("wetter", "eacdwb");
+  EXPECT_EQ(menu.edges().size(), 6U);
+  EXPECT_EQ(menu.edges()[2].step, 3U);
+  // e is joined to w twice and to a
+  EXPECT_EQ(menu.testLetter(), 'E');
+  EXPECT_EQ(menu.loops(), 1U);
+  EXPECT_THROW(Menu("wetter", "abcde"), std::invalid_argument);
+  EXPECT_THROW(Menu("wetter", "abtdef"), std::invalid_argument);
+  EXPECT_THROW(Menu("wet1er", "abcdef"), std::invalid_argument);
+}
+
+TEST(EnigmaBombeTests, orders)
+{
+  EXPECT_EQ(Bombe::orders(Model::M1).size(), 60U);
+  EXPECT_EQ(Bombe::orders(Model::M3).size(), 336U);
+  EXPECT_EQ(Bombe::orders(Model::M4).size(), 672U);
+}
+
+TEST(EnigmaBombeTests, finds_m3_key)
+{
+  // the right rotor starts past its notch, the crib does not cross a turnover
+  const std::vector<RotorId> rotors = {RotorId::II, RotorId::IV, RotorId::I};
+  const std::string          plugs  = "AV BS CG DL FU HZ IN KM OW RX";
+  const std::string          cipher = encrypt(Model::M3, ReflectorId::B, rotors, "BQR", plugs);
+
+  const Bombe bombe(plaintext.substr(0, 24), cipher.substr(0, 24));
+  const auto  stops = bombe.run(Model::M3, ReflectorId::B, {{RotorId::I, RotorId::II, RotorId::III}, rotors, {RotorId::V, RotorId::IV, RotorId::I}}, 3U);
+  const auto  found = std::find_if(stops.begin(), stops.end(), [&rotors](const Bombe::Stop &stop) { return stop.rotors == rotors && stop.offsets == "BQR"; });
+  ASSERT_NE(found, stops.end());
+  EXPECT_TRUE(implied_by(found->plugs, plugs)) << found->plugs;
+  EXPECT_LT(stops.size(), 20U);
+}
+
+TEST(EnigmaBombeTests, finds_m4_key_at_crib_position)
+{
+  const std::vector<RotorId> rotors = {RotorId::GAMMA, RotorId::VI, RotorId::III, RotorId::V};
+  const std::string          plugs  = "AE BF CM DQ HU JN LX PR SZ VW";
+  const std::string          cipher = encrypt(Model::M4, ReflectorId::ThinC, rotors, "KGZA", plugs);
+
+  // rotor V turns over from Z to A, 25 letters from A stay clear of it
+  const Bombe bombe(plaintext.substr(1, 24), cipher.substr(1, 24), 1U);
+  const auto  stops = bombe.run(Model::M4, ReflectorId::ThinC, {rotors}, 2U);
+  const auto  found = std::find_if(stops.begin(), stops.end(), [](const Bombe::Stop &stop) { return stop.offsets == "KGZA"; });
+  ASSERT_NE(found, stops.end());
+  EXPECT_TRUE(implied_by(found->plugs, plugs)) << found->plugs;
+  EXPECT_THROW(static_cast<void>(bombe.run(Model::M4, ReflectorId::B, {rotors})), std::invalid_argument);
+}
@@ -0,0 +1,236 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "blocking.hpp"
+#include "enmach/DynamicEnigma.hpp"
+#include "format.hpp"
+#include "options.hpp"
+#include "pipeline.hpp"
+#include "test_input.hpp"
+
+using namespace enmach;
+
+namespace
+{
+  auto parse(std::initializer_list<const char *> arguments) -> cli::Options
+  {
+    std::vector<const char *> argv{"enmach"};
+    argv.insert(argv.end(), arguments);
+    return cli::parse(static_cast<int>(argv.size()), argv.data());
+  }
+
+  // Letters in groups of five, ten groups per line, as GroupFormatter writes them in one call
+  auto grouped(const std::string &letters) -> std::string
+  {
+    std::string expected;
+    for (std::size_t i{}; i < letters.size(); ++i)
+    {
+      if (i != 0U)
+        expected += i % cli::GroupFormatter::line == 0U ? "\n" : i % cli::GroupFormatter::group == 0U ? " " : "";
+      expected += letters[i];
+    }
+    return letters.empty() ? expected : expected + '\n';
+  }
+
+  // Hands the completions of BlockingIo back newest first, so that the later blocks of a file arrive before the earlier
+  // ones
+  class ReversingIo
+  {
+  public:
+    explicit ReversingIo(cli::BlockingIo &io) : io_{io} {}
+
+    auto read(int fd, char *data, std::size_t size, std::uint64_t offset, std::uint64_t tag) -> void
+    {
+      this->io_.read(fd, data, size, offset, tag);
+      ++this->issued_;
+    }
+
+    auto write(int fd, const char *data, std::size_t size, std::uint64_t offset, std::uint64_t tag) -> void
+    {
+      this->io_.write(fd, data, size, offset, tag);
+      ++this->issued_;
+    }
+
+    auto wait() -> cli::Completion
+    {
+      for (; this->issued_ != 0U; --this->issued_)
+        this->held_.push_back(this->io_.wait());
+      const cli::Completion completion = this->held_.back();
+      this->held_.pop_back();
+      return completion;
+    }
+
+  private:
+    cli::BlockingIo             &io_;
+    std::size_t                  issued_{};
+    std::vector<cli::Completion> held_;
+  };
+
+  auto read_file(const std::string &path) -> std::string
+  {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  }
+
+  // Encrypts more files than the pipeline keeps open, from empty to several blocks with a partial last one, and compares
+  // every output with DynamicEnigma::transform from the same key
+  template<class Input, class Io>
+  auto expect_pipeline_matches_transform(Io &io, bool groups, const std::string &name) -> void
+  {
+    constexpr std::size_t          block = cli::Pipeline<Input, Io>::block;
+    const std::vector<std::size_t> sizes = {3U * block + 12345U, 0U, 100U, block, 2U * block - 1U, 7U, 5U * block / 2U, 1U, 333333U};
+    const std::string              directory = testing::TempDir() + name;
+    ::mkdir(directory.c_str(), 0755);
+
+    std::vector<std::string> texts;
+    std::vector<cli::Job>    jobs;
+    for (std::size_t file{}; file < sizes.size(); ++file)
+    {
+      std::string text = test_input::make_input(sizes[file], file, true);
+      for (std::size_t i = 10U + file; i < text.size(); i += 11U)
+        text[i] = " .\n"[i % 3U];
+      jobs.push_back({directory + "/input" + std::to_string(file), directory + "/output" + std::to_string(file)});
+      std::ofstream(jobs.back().input, std::ios::binary | std::ios::trunc) << text;
+      texts.push_back(std::move(text));
+    }
+
+    const DynamicEnigma key(Model::M3, ReflectorId::B, {RotorId::II, RotorId::IV, RotorId::V}, "bul", "wza", "AV BS CG DL FU HZ IN KM OW RX");
+    cli::Pipeline<Input, Io>(io, key, groups).run(jobs);
+
+    for (std::size_t file{}; file < sizes.size(); ++file)
+    {
+      DynamicEnigma machine = key;
+      std::string   expected(texts[file].size(), '\0');
+      expected.resize(static_cast<std::size_t>(machine.transform<Input>(texts[file], expected.data()) - expected.data()));
+      if (groups)
+      {
+        cli::GroupFormatter formatter;
+        std::string         formatted(cli::GroupFormatter::capacity(expected.size()) + 1U, '\0');
+        char               *end = formatter.format(expected.data(), expected.size(), formatted.data());
+        formatted.resize(static_cast<std::size_t>(formatter.finish(end) - formatted.data()));
+        expected = std::move(formatted);
+      }
+      EXPECT_EQ(expected, read_file(jobs[file].output)) << jobs[file].input;
+      std::remove(jobs[file].input.c_str());
+      std::remove(jobs[file].output.c_str());
+    }
+    ::rmdir(directory.c_str());
+  }
+} // namespace
+
+TEST(EnigmaCliTests, parse_key_and_defaults)
+{
+  const cli::Options options = parse({"-m", "M4", "--reflector", "ThinB", "-r", "beta,II,IV,I", "-s", "vjna", "-p", "AT BL", "message.txt"});
+  EXPECT_EQ(Model::M4, options.model);
+  EXPECT_EQ(ReflectorId::ThinB, options.reflector);
+  EXPECT_EQ((std::vector<RotorId>{RotorId::BETA, RotorId::II, RotorId::IV, RotorId::I}), options.rotors);
+  EXPECT_EQ("aaaa", options.rings);
+  EXPECT_EQ("vjna", options.positions);
+  EXPECT_EQ("AT BL", options.plugs);
+  EXPECT_EQ(cli::NonLetters::Strict, options.non_letters);
+  EXPECT_EQ(std::vector<std::string>{"message.txt"}, options.inputs);
+  EXPECT_EQ("-", options.output);
+
+  EXPECT_EQ(std::vector<std::string>{"-"}, parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "-o", "out.txt"}).inputs);
+  EXPECT_EQ(3U, parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "--threads", "3"}).threads);
+  EXPECT_TRUE(parse({"--help"}).help);
+}
+
+TEST(EnigmaCliTests, parse_rejects_invalid_arguments)
+{
+  // model, reflector and rotors are required
+  EXPECT_THROW(parse({"-u", "B", "-r", "I,II,III"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-r", "I,II,III"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M5", "-u", "B", "-r", "I,II,III"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,IX"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "--threads", "0"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "--verbose"}), std::invalid_argument);
+}
+
+TEST(EnigmaCliTests, parse_groups)
+{
+  const cli::Options options = parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "--groups"});
+  EXPECT_TRUE(options.groups);
+  EXPECT_EQ(cli::NonLetters::Strip, options.non_letters);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "--groups", "--passthrough"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "--passthrough", "--groups"}), std::invalid_argument);
+}
+
+TEST(EnigmaCliTests, groups_across_calls)
+{
+  std::string letters;
+  for (std::size_t i{}; i < 123U; ++i)
+    letters += static_cast<char>('a' + i % 26U);
+
+  // pieces of 1, 4, 9, ... letters end anywhere inside a group or a line
+  cli::GroupFormatter formatter;
+  std::string         output(cli::GroupFormatter::capacity(letters.size()) + 1U, '\0');
+  char               *end = output.data();
+  for (std::size_t offset{}, piece = 1U; offset < letters.size(); offset += piece, piece += 3U)
+  {
+    const std::size_t count = std::min(piece, letters.size() - offset);
+    char *const       next  = formatter.format(letters.data() + offset, count, end);
+    EXPECT_LE(static_cast<std::size_t>(next - end), cli::GroupFormatter::capacity(count));
+    end = next;
+  }
+  end = formatter.finish(end);
+  output.resize(static_cast<std::size_t>(end - output.data()));
+  EXPECT_EQ(grouped(letters), output);
+
+  // finish ends a line only once, and a fresh line starts without a separator
+  EXPECT_EQ(end, formatter.finish(end));
+  std::string second(8U, '\0');
+  second.resize(static_cast<std::size_t>(formatter.finish(formatter.format("abcdef", 6U, second.data())) - second.data()));
+  EXPECT_EQ("abcde f\n", second);
+  EXPECT_EQ(grouped(letters.substr(0, 50U)), "abcde fghij klmno pqrst uvwxy zabcd efghi jklmn opqrs tuvwx\n");
+}
+
+TEST(EnigmaCliTests, parse_output_dir)
+{
+  const cli::Options options = parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "-d", "out", "--io", "threads", "a.txt", "b.txt"});
+  EXPECT_EQ("out", options.output_dir);
+  EXPECT_EQ(cli::IoBackend::Threads, options.io);
+  EXPECT_EQ((std::vector<std::string>{"a.txt", "b.txt"}), options.inputs);
+
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "-d", "out", "-o", "c.txt", "a.txt"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "-d", "out"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "a.txt", "b.txt"}), std::invalid_argument);
+  EXPECT_THROW(parse({"-m", "M3", "-u", "B", "-r", "I,II,III", "-d", "out", "--io", "aio", "a.txt"}), std::invalid_argument);
+}
+
+TEST(EnigmaCliTests, pipeline_matches_transform)
+{
+  cli::BlockingIo io(cli::Pipeline<input::Passthrough, cli::BlockingIo>::slots, 4U);
+  expect_pipeline_matches_transform<input::Passthrough>(io, false, "enmach_pipeline_passthrough");
+}
+
+TEST(EnigmaCliTests, pipeline_blocks_out_of_order)
+{
+  cli::BlockingIo io(cli::Pipeline<input::SkipNonLetters, ReversingIo>::slots, 4U);
+  ReversingIo     reversing(io);
+  expect_pipeline_matches_transform<input::SkipNonLetters>(reversing, true, "enmach_pipeline_groups");
+  expect_pipeline_matches_transform<input::SkipNonLetters>(reversing, false, "enmach_pipeline_strip");
+}
+
+TEST(EnigmaCliTests, pipeline_missing_input)
+{
+  using Pipeline = cli::Pipeline<input::Strict, cli::BlockingIo>;
+  cli::BlockingIo             io(Pipeline::slots, 2U);
+  const DynamicEnigma         key(Model::M1, ReflectorId::A, {RotorId::I, RotorId::II, RotorId::III}, "aaa", "aaa");
+  const std::vector<cli::Job> jobs = {{testing::TempDir() + "enmach_pipeline_missing", testing::TempDir() + "enmach_pipeline_missing.out"}};
+  EXPECT_THROW(Pipeline(io, key, false).run(jobs), std::system_error);
+}
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "enmach/enmach.hpp"
+#include "test_input.hpp"
+
+using namespace enmach;
+using test_input::make_input;
+
+TEST(EnigmaCompiledKeyTests, cursor_matches_dynamic)
+{
+  const std::string plugs = "AV BS CG DL FU HZ IN KM OW RX";
+  const CompiledKey key(Model::M4, ReflectorId::ThinB, {RotorId::BETA, RotorId::II, RotorId::IV, RotorId::I}, "aaav", "vjna", plugs);
+  const std::string input = make_input(1000);
+  for (const auto isa : {simd::Isa::Scalar, simd::Isa::SSSE3, simd::Isa::AVX2})
+  {
+    DynamicEnigma machine(Model::M4, ReflectorId::ThinB, {RotorId::BETA, RotorId::II, RotorId::IV, RotorId::I}, "aaav", "vjna", plugs);
+    std::string   expected(input.size(), '\0');
+    machine.transform(input, expected.data(), isa);
+
+    // in uneven pieces, the cursor carries the position between calls
+    Cursor      cursor = key.cursor();
+    std::string output(input.size(), '\0');
+    for (std::size_t first{}; first < input.size(); first += 97U)
+    {
+      const std::size_t last = std::min(first + 97U, input.size());
+      key.transform(cursor, input.data() + first, input.data() + last, output.data() + first, isa);
+    }
+    EXPECT_EQ(output, expected);
+    EXPECT_EQ(cursor, machine.cursor());
+  }
+}
+
+TEST(EnigmaCompiledKeyTests, exec_and_increment)
+{
+  const CompiledKey key(Model::M3, ReflectorId::B, {RotorId::VI, RotorId::VII, RotorId::VIII}, "hlk", "qev", "AB CD");
+  DynamicEnigma     machine(Model::M3, ReflectorId::B, {RotorId::VI, RotorId::VII, RotorId::VIII}, "hlk", "qev", "AB CD");
+  Cursor            cursor = key.cursor();
+  for (std::size_t press{}; press < 2000U; ++press)
+  {
+    key.increment(cursor);
+    machine.increment();
+    ASSERT_EQ(key.exec(cursor, 'e'), machine.exec('e'));
+    ASSERT_EQ(cursor, key.cursor(press + 1U));
+  }
+}
+
+TEST(EnigmaCompiledKeyTests, shared_between_threads)
+{
+  const auto        key   = std::make_shared<const CompiledKey>(Model::M1, ReflectorId::B, std::vector<RotorId>{RotorId::I, RotorId::II, RotorId::III}, "aaa", "aaa", "AV BS");
+  const std::string input = make_input(20000);
+
+  std::vector<std::string> outputs(4, std::string(input.size(), '\0'));
+  std::string              sliced(input.size(), '\0');
+  std::vector<std::thread> threads;
+  for (std::size_t thread{}; thread < outputs.size(); ++thread)
+    threads.emplace_back([&key, &input, &outputs, &sliced, thread] {
+      // each thread starts at its own slice of the message
+      const std::size_t first  = thread * input.size() / 4U;
+      const std::size_t last   = (thread + 1U) * input.size() / 4U;
+      Cursor            cursor = key->cursor(first);
+      key->transform(cursor, input.data() + first, input.data() + last, sliced.data() + first);
+      DynamicEnigma machine(key);
+      machine.transform(input, outputs[thread].data());
+    });
+  for (auto &thread : threads)
+    thread.join();
+
+  DynamicEnigma machine(Model::M1, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "aaa", "aaa", "AV BS");
+  std::string   expected(input.size(), '\0');
+  machine.transform(input, expected.data());
+  for (const auto &output : outputs)
+    EXPECT_EQ(output, expected);
+  EXPECT_EQ(sliced, expected);
+}
+
+TEST(EnigmaCompiledKeyTests, copies_share_the_key)
+{
+  DynamicEnigma machine(Model::M1, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "aaa", "aaa");
+  DynamicEnigma copy = machine;
+  EXPECT_EQ(copy.key(), machine.key());
+  copy.advance(10U);
+  EXPECT_EQ(machine.position(), 0U);
+  EXPECT_NE(copy.cursor(), machine.cursor());
+  EXPECT_THROW(DynamicEnigma{std::shared_ptr<const CompiledKey>{}}, std::invalid_argument);
+  EXPECT_THROW(static_cast<void>(machine.key()->cursor(pack({0, 0, 0}, 3))), std::invalid_argument);
+}
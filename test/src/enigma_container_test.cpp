@@ -0,0 +1,96 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "enmach/container.hpp"
+#include "enmach/enmach.hpp"
+#include "test_input.hpp"
+
+using namespace enmach;
+
+namespace
+{
+  auto m4_key() -> container::Key { return {Model::M4, ReflectorId::ThinC, {RotorId::BETA, RotorId::V, RotorId::VI, RotorId::VIII}, "AAEL", "IGZQ", "AE BF CM DQ HU JN LX PR SZ VW"}; }
+
+  auto make_text(std::size_t size, bool separators) -> std::string
+  {
+    std::string text = test_input::make_input(size);
+    for (std::size_t i = 10U; separators && i < size; i += 11U)
+      text[i] = " .\n"[i % 3U];
+    return text;
+  }
+
+  auto write_container(const container::Key &key, std::string_view text, container::Content content, std::uint32_t chunk_size) -> std::string
+  {
+    std::stringstream stream;
+    container::Writer writer(stream, key, content, chunk_size);
+    // uneven pieces cross the chunk boundaries at different points
+    for (std::size_t offset{}, piece = 1U; offset < text.size(); offset += piece, piece = piece * 3U % 1000U + 1U)
+      writer.write(text.substr(offset, piece));
+    writer.finish();
+    return stream.str();
+  }
+} // namespace
+
+TEST(EnigmaContainerTests, round_trip_and_ranges)
+{
+  for (const auto content : {container::Content::Letters, container::Content::Passthrough})
+  {
+    const std::string text      = make_text(20000U, content == container::Content::Passthrough);
+    std::stringstream stream(write_container(m4_key(), text, content, 4096U));
+    container::Reader reader(stream);
+    ASSERT_EQ(reader.size(), text.size());
+    ASSERT_EQ(reader.chunks(), 5U);
+
+    // stored as the ciphertext of the whole text, read back as the (lowercase) plaintext
+    std::string ciphertext(text.size(), '\0');
+    m4_key().machine().transform<input::Passthrough>(text, ciphertext.data());
+    ASSERT_EQ(stream.str().substr(container::header_size, text.size()), ciphertext);
+
+    std::string expected = text;
+    for (char &character : expected)
+      character = is_letter(character) ? to_lowercase(character) : character;
+    ASSERT_EQ(reader.read(0U, text.size()), expected);
+    for (const std::size_t offset : {0U, 1U, 4095U, 4096U, 4097U, 10000U, 19999U})
+      for (const std::size_t length : {0U, 1U, 33U, 5000U})
+        ASSERT_EQ(reader.read(offset, length), expected.substr(offset, length)) << offset << " " << length;
+  }
+}
+
+TEST(EnigmaContainerTests, key_survives)
+{
+  std::stringstream stream(write_container(m4_key(), "abc", container::Content::Letters, container::default_chunk));
+  container::Reader reader(stream);
+  ASSERT_EQ(reader.key().model, Model::M4);
+  ASSERT_EQ(reader.key().reflector, ReflectorId::ThinC);
+  ASSERT_EQ(reader.key().rotors, m4_key().rotors);
+  ASSERT_EQ(reader.key().rings, "aael");
+  ASSERT_EQ(reader.key().positions, "igzq");
+  ASSERT_EQ(reader.key().plugs, "aebfcmdqhujnlxprszvw");
+  ASSERT_EQ(reader.content(), container::Content::Letters);
+}
+
+TEST(EnigmaContainerTests, errors)
+{
+  std::stringstream output;
+  container::Writer writer(output, m4_key());
+  ASSERT_THROW(writer.write("abc d"), std::invalid_argument);
+  ASSERT_EQ(writer.size(), 0U);
+  ASSERT_THROW(container::Writer(output, m4_key(), container::Content::Letters, 0U), std::invalid_argument);
+
+  std::string       bytes = write_container(m4_key(), make_text(100U, false), container::Content::Letters, 16U);
+  std::stringstream valid(bytes);
+  container::Reader reader(valid);
+  ASSERT_EQ(reader.read(100U, 10U), "");
+  ASSERT_THROW(reader.read(101U, 1U), std::out_of_range);
+
+  std::stringstream truncated(bytes.substr(0U, bytes.size() - 1U));
+  ASSERT_THROW((container::Reader(truncated)), std::invalid_argument);
+  bytes[0] = 'X';
+  std::stringstream corrupted(bytes);
+  ASSERT_THROW((container::Reader(corrupted)), std::invalid_argument);
+}
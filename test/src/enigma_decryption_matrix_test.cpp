@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "enmach/Arena.hpp"
+#include "enmach/DecryptionMatrix.hpp"
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+
+namespace
+{
+  const std::string ciphertext = "qbltwlduokgasbcgzfkiuxeiwmpnrbvbmqtemhbyzxrbhxjjduvnmjvfvtxlpeewwrwxfjbudnnoncqpd";
+
+  // The matrix row of position against the machine started there
+  auto expect_row(const DecryptionMatrix &matrix, const CompiledKey &key, std::size_t position) -> void
+  {
+    Cursor      cursor = matrix.cursor(position);
+    std::string plaintext(ciphertext.size(), '\0');
+    key.transform(cursor, ciphertext, plaintext.data());
+    const std::uint8_t *row = matrix.row(position);
+    for (std::size_t offset{}; offset < ciphertext.size(); ++offset)
+      ASSERT_EQ(row[offset], plaintext[offset] - 'a') << "position " << position << " offset " << offset;
+  }
+} // namespace
+
+TEST(EnigmaDecryptionMatrixTests, arena)
+{
+  Arena arena(1000U);
+  EXPECT_EQ(arena.capacity(), std::size_t{1} << 21U);
+  const auto *bytes = arena.allocate<std::uint8_t>(3U);
+  const auto *words = arena.allocate<std::uint64_t>(2U);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(bytes) % Arena::alignment, 0U);
+  EXPECT_EQ(reinterpret_cast<const std::uint8_t *>(words) - bytes, 64);
+  EXPECT_EQ(arena.used(), 128U);
+  EXPECT_THROW(static_cast<void>(arena.allocate<std::uint8_t>(arena.capacity())), std::bad_alloc);
+  arena.reset();
+  EXPECT_EQ(arena.used(), 0U);
+  EXPECT_EQ(arena.allocate<std::uint8_t>(arena.capacity()), bytes);
+}
+
+TEST(EnigmaDecryptionMatrixTests, m3)
+{
+  // VI and VIII have two notches each, the middle rotor double steps twice as often
+  const CompiledKey key(Model::M3, ReflectorId::B, {RotorId::II, RotorId::VI, RotorId::VIII}, "amk", "aaa", "AB CD");
+  Arena             arena(DecryptionMatrix::bytes(ciphertext.size()));
+  EXPECT_THROW(DecryptionMatrix(arena, key, "ab1"), std::invalid_argument);
+
+  const DecryptionMatrix matrix(arena, key, ciphertext);
+  EXPECT_EQ(matrix.length(), ciphertext.size());
+  EXPECT_EQ(DecryptionMatrix::stride(ciphertext.size()), 128U);
+  EXPECT_LE(arena.used(), DecryptionMatrix::bytes(ciphertext.size()));
+  EXPECT_EQ(matrix.row(1U) - matrix.row(0U), 128);
+  EXPECT_EQ(matrix.row(0U)[ciphertext.size()], 0U);
+  EXPECT_THROW(static_cast<void>(matrix.row(DecryptionMatrix::positions)), std::out_of_range);
+  EXPECT_THROW(static_cast<void>(matrix.scrambler(0U, ciphertext.size())), std::out_of_range);
+
+  // the plugs of the key are not part of the matrix
+  const CompiledKey unplugged(Model::M3, ReflectorId::B, {RotorId::II, RotorId::VI, RotorId::VIII}, "amk", "aaa");
+  for (std::size_t position{}; position < DecryptionMatrix::positions; position += 37U)
+    expect_row(matrix, unplugged, position);
+
+  const CompiledKey start(Model::M3, ReflectorId::B, {RotorId::II, RotorId::VI, RotorId::VIII}, "amk", "bqr");
+  const std::size_t position = DecryptionMatrix::position(start.cursor());
+  EXPECT_EQ(matrix.cursor(position), start.cursor());
+  expect_row(matrix, unplugged, position);
+
+  const std::uint8_t letter = static_cast<std::uint8_t>(ciphertext[40] - 'a');
+  EXPECT_EQ(matrix.scrambler(position, 40U)[letter], matrix.row(position)[40]);
+}
+
+TEST(EnigmaDecryptionMatrixTests, m4)
+{
+  const CompiledKey key(Model::M4, ReflectorId::ThinC, {RotorId::BETA, RotorId::V, RotorId::VI, RotorId::VIII}, "aael", "kaaa");
+  Arena             arena(DecryptionMatrix::bytes(ciphertext.size()));
+  const DecryptionMatrix matrix(arena, key, ciphertext);
+  EXPECT_THROW(DecryptionMatrix(arena, key, ciphertext), std::bad_alloc);
+  for (std::size_t position = 5U; position < DecryptionMatrix::positions; position += 101U)
+    expect_row(matrix, key, position);
+}
@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+#include "test_input.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+using test_input::make_input;
+
+namespace
+{
+  template<class PlugboardValue>
+  struct Plugboard : public PlugboardValue
+  {
+    constexpr auto operator()(char letter) const -> char { return PlugboardValue::value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  template<class EM>
+  auto decrypt(EM &em, const std::string_view &input) -> std::string
+  {
+    std::string output;
+    output.reserve(input.size());
+    for (const auto &character : input)
+    {
+      em.increment();
+      output += em.exec(character);
+    }
+    return output;
+  }
+} // namespace
+
+TEST(EnigmaDynamicTests, m1_matches_expected)
+{
+  DynamicEnigma m1(Model::M1, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "AAA"sv, "AAA"sv);
+  ASSERT_EQ("bdzgo"sv, decrypt(m1, "aaaaa"sv));
+}
+
+TEST(EnigmaDynamicTests, m3_matches_template_machine)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "zbcdrwghuylkmnopqestivfxja"sv; };
+  // clang-format on
+  enmach::EnigmaM3<Plugboard<PlugboardValue>, ukw::C, VI, III, VIII> reference;
+  reference.setGrundstellung('h', 'l', 'k');
+  reference.setRingstellung('h', 'l', 'k');
+  DynamicEnigma m3(model_from_name("m3"sv), reflector_from_name("C"sv), {rotor_from_name("VI"sv), rotor_from_name("iii"sv), rotor_from_name("VIII"sv)}, "HLK"sv, "hlk"sv, "AZ ER FW IU JY KL"sv);
+
+  const std::string input = make_input(20000U);
+  for (auto isa : {simd::Isa::Scalar, simd::Isa::SSSE3, simd::Isa::AVX2})
+  {
+    auto          expected_machine = reference;
+    DynamicEnigma dynamic          = m3;
+    std::string   expected(input.size(), '\0');
+    std::string   output(input.size(), '\0');
+    expected_machine.transform(input, expected.data(), isa);
+    dynamic.transform(input, output.data(), isa);
+    ASSERT_EQ(expected, output);
+  }
+  ASSERT_EQ(decrypt(reference, input.substr(0U, 1000U)), decrypt(m3, input.substr(0U, 1000U)));
+}
+
+TEST(EnigmaDynamicTests, m4_matches_expected)
+{
+  DynamicEnigma              m4(Model::M4, ReflectorId::ThinC, {RotorId::BETA, RotorId::V, RotorId::VI, RotorId::VIII}, "AAEL"sv, "IGZQ"sv, "ae bf cm dq hu jn lx pr sz vw"sv);
+  constexpr std::string_view input    = "twnhyazgbilshewpglbpqlwqekitiafgzhwimcwdfxpafeilqzwfnrfttqhuoadvlrlgaoqkvlwlsjhwofjjsluveynrrajaqdkqbgmfycevkpfjpkowhhqzyzeqrtqikkxixtfpoemi"sv;
+  constexpr std::string_view expected = "fxdxuuuostyfuncquuufxwttxvvvuuueinseinsnuldreikkeiselekkxxistsechsstuendlichesdockenvormittagsamdreixfunfxinrendsburggemxfxdxuuuostmoeglichl"sv;
+  const PackedState          start    = m4.snapshot();
+
+  std::string output(input.size(), '\0');
+  m4.transform(input, output.data());
+  ASSERT_EQ(expected, output);
+
+  m4.rewind(input.size());
+  ASSERT_EQ(start, m4.snapshot());
+  const StepSequence sequence = m4.stepSequence();
+  m4.transform(input, output.data(), sequence);
+  ASSERT_EQ(expected, output);
+}
+
+TEST(EnigmaDynamicTests, invalid_configuration)
+{
+  const std::vector<RotorId> m3_rotors{RotorId::I, RotorId::II, RotorId::VI};
+  ASSERT_THROW(DynamicEnigma(Model::M1, ReflectorId::B, m3_rotors, "AAA"sv, "AAA"sv), std::invalid_argument);
+  ASSERT_NO_THROW(DynamicEnigma(Model::M3, ReflectorId::B, m3_rotors, "AAA"sv, "AAA"sv));
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::ThinB, m3_rotors, "AAA"sv, "AAA"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::B, {RotorId::I, RotorId::I, RotorId::II}, "AAA"sv, "AAA"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::B, {RotorId::BETA, RotorId::I, RotorId::II}, "AAA"sv, "AAA"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M4, ReflectorId::ThinB, {RotorId::I, RotorId::II, RotorId::III, RotorId::IV}, "AAAA"sv, "AAAA"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M4, ReflectorId::B, {RotorId::BETA, RotorId::II, RotorId::III, RotorId::IV}, "AAAA"sv, "AAAA"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::B, m3_rotors, "AA"sv, "AAA"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::B, m3_rotors, "AAA"sv, "A.A"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::B, m3_rotors, "AAA"sv, "AAA"sv, "AB AC"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::B, m3_rotors, "AAA"sv, "AAA"sv, "AA"sv), std::invalid_argument);
+  ASSERT_THROW(DynamicEnigma(Model::M3, ReflectorId::B, m3_rotors, "AAA"sv, "AAA"sv, "ABC"sv), std::invalid_argument);
+  ASSERT_THROW((void)rotor_from_name("IX"sv), std::invalid_argument);
+  ASSERT_THROW((void)reflector_from_name("D"sv), std::invalid_argument);
+  ASSERT_THROW((void)model_from_name("M2"sv), std::invalid_argument);
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+
+namespace
+{
+  template<class PlugboardValue>
+  struct Plugboard : public PlugboardValue
+  {
+    constexpr auto operator()(char letter) const -> char { return PlugboardValue::value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  template<class... RotorTags>
+  auto engines_agree() -> bool
+  {
+    bool result{true};
+    for (std::uint8_t offset{}; offset < ETW.size(); ++offset)
+      for (std::uint8_t index{}; index < ETW.size(); ++index)
+      {
+        result = result && ((rotor_engine::Table::forward<RotorTags>(offset, index) == rotor_engine::Arithmetic::forward<RotorTags>(offset, index)) && ...);
+        result = result && ((rotor_engine::Table::inverse<RotorTags>(offset, index) == rotor_engine::Arithmetic::inverse<RotorTags>(offset, index)) && ...);
+      }
+    return result;
+  }
+} // namespace
+
+TEST(EnigmaEngineTests, table_matches_arithmetic)
+{
+  ASSERT_TRUE((engines_agree<I, II, III, IV, V, VI, VII, VIII, BETA, GAMMA>()));
+}
+
+TEST(EnigmaEngineTests, arithmetic_engine_m3)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "zbcdrwghuylkmnopqestivfxja"sv; };
+  // clang-format on
+  with_engine_t<enmach::EnigmaM3<Plugboard<PlugboardValue>, ukw::C, VI, III, VIII>, rotor_engine::Arithmetic> m3;
+  m3.setGrundstellung('h', 'l', 'k');
+  m3.setRingstellung('h', 'l', 'k');
+  constexpr std::string_view input    = "nvkzhgdhmangsvksyiznoxqgknszoxbuiwoqueocihvvklgkgaemkxlpwlvg"sv;
+  constexpr std::string_view expected = "vinnjluztqxkpqlthluanqvljpankrdljtvhevnrkidyvschxisntajnacmo"sv;
+  std::string                output(input.size(), '\0');
+  m3.transform(input, output.data());
+  ASSERT_EQ(expected, output);
+}
@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "enmach/HillClimb.hpp"
+#include "enmach/Ngrams.hpp"
+#include "enmach/PlugboardSearch.hpp"
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+
+namespace
+{
+  // training text for the n-gram statistics, unrelated to the message
+  const std::string corpus =
+      "The harbour was quiet when the first boats came back from the night fishing. Along the wall the old men sat in the sun and talked about the weather, the price of fuel and the young people who had left the village for the city. Every morning the baker opened his shop at six, and the smell of fresh bread drifted down the narrow street towards the water. Children ran past the church on their way to school, and the teacher, who had lived there for more than thirty years, waved at each of them from the window of her small house. "
+      "In the afternoon the wind usually turned to the west and the clouds came in from the sea. The farmers on the hills above the town watched the sky carefully, because a heavy rain at the wrong time could ruin the harvest. They had learned over many generations to read the colour of the evening light and the shape of the clouds, and most of them trusted those signs more than the forecast on the radio. "
+      "The railway line that connected the village with the rest of the country had been built at the end of the nineteenth century. At that time it was considered a great achievement, and people travelled for hours to see the first train arrive at the station. Today only two trains stop there each day, one in the morning and one in the evening, and the station master spends most of his time tending the flowers on the platform. "
+      "There is a long tradition of music in the region. On summer evenings the band plays in the square in front of the town hall, and families bring chairs and blankets to listen. The musicians are mostly amateurs who work during the day as carpenters, nurses, clerks or mechanics, but they practise every week and take great pride in their performances. Visitors are often surprised by the quality of the playing and by the warm welcome they receive from the people who live here. "
+      "Scientists who study the history of the coast have found evidence that people settled in this area thousands of years ago. They were hunters and fishermen who followed the seasons, moving inland in winter and returning to the shore when the weather improved. Their tools and the remains of their fires can still be found in the caves along the cliffs, and a small museum near the harbour shows some of the most important discoveries. "
+      "During the war the village was occupied for several years. Many of the older residents still remember the soldiers, the shortages of food and the long nights without light. Some of the young men joined the resistance and carried messages through the mountains at great risk. After the liberation a monument was built on the hill, and every year on the anniversary the whole community gathers there in silence to remember those who did not return. "
+      "The economy of the region has changed a great deal over the last fifty years. Fishing and farming are still important, but tourism now provides most of the jobs. Hotels and restaurants have opened along the beach, and in the summer months the population of the town more than doubles. Some people welcome the visitors and the money they bring, while others worry that the character of the place is being lost and that the young cannot afford to buy a house in the village where they grew up. "
+      "Education has always been valued here. The school was founded by the parish more than two hundred years ago, and for a long time it was the only place where the children of poor families could learn to read and write. Today it has modern classrooms and computers, but the teachers still take the pupils on long walks through the forest to learn the names of the trees, the birds and the flowers, just as their own teachers did when they were young. "
+      "Every autumn there is a market in the square where farmers sell apples, cheese, honey and wine. People come from all the surrounding villages, and the day usually ends with dancing and singing that continues long into the night. It is one of the few occasions in the year when almost everyone in the community meets, and many friendships and marriages have begun at the autumn market. "
+      "The doctor who serves the village also visits several smaller settlements in the mountains. In winter, when the roads are covered with snow, he sometimes has to travel on foot or on skis to reach his patients. He says that the work is hard but rewarding, and that he would not want to exchange it for a position in a large hospital in the city, where he would never get to know the people he treats. ";
+
+  const std::string message = "theweatherreportforthenortherncoastpredictsstrongwindsfromthewestduringthenightandheavyraininthemorning"
+                              "allshipsintheharbourshouldremainatanchoruntilthestormhaspassedandthecaptainsmustreporttheirpositions"
+                              "tothenavalcommandeveryfourhoursuntilfurthernotice";
+} // namespace
+
+TEST(EnigmaHillClimbTests, index_of_coincidence)
+{
+  std::array<std::size_t, 26> counts{};
+  counts.fill(1U);
+  EXPECT_DOUBLE_EQ(index_of_coincidence(counts, 26U), 0.0);
+  const std::vector<std::uint8_t> same(10U, 4U);
+  EXPECT_DOUBLE_EQ(index_of_coincidence(same.data(), same.size()), 1.0);
+  EXPECT_DOUBLE_EQ(index_of_coincidence(same.data(), 1U), 0.0);
+}
+
+TEST(EnigmaHillClimbTests, ngrams)
+{
+  EXPECT_THROW(Ngrams(corpus, 0U), std::invalid_argument);
+  EXPECT_THROW(Ngrams(corpus, 5U), std::invalid_argument);
+  EXPECT_THROW(Ngrams("ab 1", 3U), std::invalid_argument);
+
+  const Ngrams trigrams(corpus, 3U);
+  EXPECT_EQ(trigrams.n(), 3U);
+  // english scores higher than the same letters shuffled
+  const std::vector<std::uint8_t> the = {19U, 7U, 4U};
+  const std::vector<std::uint8_t> eht = {4U, 7U, 19U};
+  EXPECT_GT(trigrams.score(the.data(), the.size()), trigrams.score(eht.data(), eht.size()));
+  EXPECT_DOUBLE_EQ(trigrams.score(the.data(), 2U), 0.0);
+}
+
+TEST(EnigmaHillClimbTests, plugboard_search)
+{
+  const std::vector<RotorId> rotors = {RotorId::II, RotorId::IV, RotorId::I};
+  DynamicEnigma              machine(Model::M3, ReflectorId::B, rotors, "amk", "bqr", "AV BS CG DL FU HZ IN KM");
+  std::string                ciphertext(message.size(), '\0');
+  machine.transform(message, ciphertext.data());
+
+  // the plugs of the key are ignored
+  const CompiledKey key(Model::M3, ReflectorId::B, rotors, "amk", "bqr", "AB");
+  PlugboardSearch   search(key, ciphertext);
+  EXPECT_EQ(search.plugs(), Steckerbrett().table());
+  EXPECT_THROW(PlugboardSearch(key, "abc1"), std::invalid_argument);
+
+  const Ngrams bigrams(corpus, 2U);
+  const Ngrams trigrams(corpus, 3U);
+  EXPECT_GT(search.climbIndexOfCoincidence(), 0.05);
+  search.climb(bigrams);
+  const double score = search.climb(trigrams);
+
+  EXPECT_EQ(search.plugs(), Steckerbrett("AV BS CG DL FU HZ IN KM").table());
+  std::string plaintext;
+  for (const std::uint8_t letter : search.plaintext())
+    plaintext += static_cast<char>('a' + letter);
+  EXPECT_EQ(plaintext, message);
+
+  search.setPlugs(Steckerbrett("AV").table());
+  EXPECT_EQ(search.plugs(), Steckerbrett("AV").table());
+  EXPECT_LT(search.score(trigrams), score);
+}
+
+TEST(EnigmaHillClimbTests, invalid)
+{
+  EXPECT_THROW(HillClimb("abc", Ngrams(corpus, 3U), Ngrams(corpus, 3U)), std::invalid_argument);
+  EXPECT_THROW(HillClimb("ab", Ngrams(corpus, 2U), Ngrams(corpus, 3U)), std::invalid_argument);
+  EXPECT_THROW(HillClimb("ab cd", Ngrams(corpus, 2U), Ngrams(corpus, 3U)), std::invalid_argument);
+  const HillClimb attack("abcdef", Ngrams(corpus, 2U), Ngrams(corpus, 3U));
+  EXPECT_THROW(static_cast<void>(attack.run(Model::M3, ReflectorId::ThinB, {{RotorId::I, RotorId::II, RotorId::III}}, 1U)), std::invalid_argument);
+  EXPECT_TRUE(attack.run(Model::M3, ReflectorId::B, std::vector<std::vector<RotorId>>{}, 1U).empty());
+}
+
+TEST(EnigmaHillClimbTests, finds_m3_key)
+{
+  const std::vector<RotorId> rotors = {RotorId::II, RotorId::IV, RotorId::I};
+  DynamicEnigma              machine(Model::M3, ReflectorId::B, rotors, "amk", "bqr", "AV BS CG DL FU HZ");
+  std::string                ciphertext(message.size(), '\0');
+  machine.transform(message, ciphertext.data());
+
+  const HillClimb                        attack(ciphertext, Ngrams(corpus, 2U), Ngrams(corpus, 3U));
+  const std::vector<std::vector<RotorId>> orders = {{RotorId::I, RotorId::II, RotorId::III}, rotors, {RotorId::V, RotorId::III, RotorId::VIII}};
+  const auto                             results = attack.run(Model::M3, ReflectorId::B, orders, 2U);
+  ASSERT_FALSE(results.empty());
+  // the left ring is not found, an equivalent key with the same turnovers is
+  EXPECT_EQ(results[0].rotors, rotors);
+  EXPECT_EQ(results[0].plugs, "AV BS CG DL FU HZ");
+  EXPECT_EQ(results[0].plaintext, message);
+
+  DynamicEnigma found(Model::M3, ReflectorId::B, results[0].rotors, results[0].rings, results[0].positions, results[0].plugs);
+  std::string   plaintext(ciphertext.size(), '\0');
+  found.transform(ciphertext, plaintext.data());
+  EXPECT_EQ(plaintext, message);
+}
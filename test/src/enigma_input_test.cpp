@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+
+namespace
+{
+  template<class PlugboardValue>
+  struct Plugboard : public PlugboardValue
+  {
+    constexpr auto operator()(char letter) const -> char { return PlugboardValue::value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "aqhijflcdepgmvukbrzyonwxts"sv; };
+  // clang-format on
+  using M4 = enmach::EnigmaM4<Plugboard<PlugboardValue>, ukw::ThinB, GAMMA, IV, III, VIII>;
+
+  auto make_m4() -> M4
+  {
+    M4 m4;
+    m4.setGrundstellung('l', 'p', 'w', 'j');
+    m4.setRingstellung('a', 'a', 'c', 'u');
+    return m4;
+  }
+
+  // Letters, spaces, digits and punctuation, longer than input::chunk
+  auto make_mixed_input(std::size_t size) -> std::string
+  {
+    constexpr std::string_view alphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ .,\n0@[`{"sv;
+    std::string                input(size, '\0');
+    for (std::size_t i{}; i < size; ++i)
+      input[i] = alphabet[(i * 37 + i / 101) % alphabet.size()];
+    // whole runs of letters hit the 64 letter fast path
+    for (std::size_t i = 512U; i < 1024U; ++i)
+      input[i] = static_cast<char>('a' + i % 26);
+    return input;
+  }
+
+  // Reference: non letters are copied without stepping
+  template<class EM>
+  auto passthrough(EM &em, const std::string_view &input) -> std::string
+  {
+    std::string output;
+    for (const auto &character : input)
+    {
+      if (!is_letter(character))
+      {
+        output += character;
+        continue;
+      }
+      em.increment();
+      output += em.exec(character);
+    }
+    return output;
+  }
+} // namespace
+
+TEST(EnigmaInputTests, placeholder_matches_test_vector)
+{
+  M4                         m4       = make_m4();
+  constexpr std::string_view input    = "nrnrsecndekhlhjimhlccoilhtwsmpxsgpgfteuburwwmszmpenlqayeojcqtzeyrmhytdufbzywmfvqesqgywtohwkdsumorbgzirjeewcqkbuzjyjrgopxdtwuenuiokvtdvnrvewkdnp.jaf.....wltpqayu.xfpx.uahktqtvyouzkmzyehvrsrgjjyizuphkxbpbpwkuruygxhgklj"sv;
+  constexpr std::string_view expected = "komxadmxuuubooteyfxdxuuuausbxvonvonjottowuenschexxueberwegzwoywegdreiundwegvieralleinmarschnachjneustadtjangetretenxmarschfahrteinszwosmschaltu.ggr.....enundnnn.bbxn.rwegenkarteninwarnemuendeuedrostocknichtbekommenxp"sv;
+  std::string                output(input.size(), '\0');
+  char                      *end = m4.transform<input::Placeholder>(input, output.data());
+  ASSERT_EQ(output.data() + output.size(), end);
+  ASSERT_EQ(expected, output);
+  ASSERT_EQ(input.size(), m4.position());
+}
+
+TEST(EnigmaInputTests, passthrough_and_skip)
+{
+  const std::string input = make_mixed_input(3U * input::chunk + 77U);
+  for (auto isa : {simd::Isa::Scalar, simd::Isa::SSSE3, simd::Isa::AVX2})
+  {
+    M4                reference = make_m4();
+    M4                copied    = make_m4();
+    M4                skipped   = make_m4();
+    const std::string expected  = passthrough(reference, input);
+
+    std::string output(input.size(), '\0');
+    ASSERT_EQ(output.data() + output.size(), copied.transform<input::Passthrough>(input, output.data(), isa));
+    ASSERT_EQ(expected, output);
+    ASSERT_EQ(reference.position(), copied.position());
+
+    // in place
+    output   = input;
+    char *end = skipped.transform<input::SkipNonLetters>(output.data(), output.data() + output.size(), output.data(), isa);
+    output.resize(static_cast<std::size_t>(end - output.data()));
+    std::string letters;
+    for (const auto &character : expected)
+      if (is_letter(character))
+        letters += character;
+    ASSERT_EQ(letters, output);
+    ASSERT_EQ(reference.exec('a'), skipped.exec('a'));
+  }
+}
+
+TEST(EnigmaInputTests, machine_policy)
+{
+  using PassthroughM4 = with_input_t<M4, input::Passthrough>;
+  PassthroughM4 m4;
+  m4.setGrundstellung('l', 'p', 'w', 'j');
+  m4.setRingstellung('a', 'a', 'c', 'u');
+  M4 strict = make_m4();
+
+  constexpr std::string_view input = "NRNRS ECNDE KHLHJ"sv;
+  std::string                output(input.size(), '\0');
+  m4.transform(input, output.data());
+  ASSERT_EQ("komxa dmxuu uboot"sv, output);
+  ASSERT_THROW(strict.transform(input, output.data()), std::invalid_argument);
+  ASSERT_EQ(0U, strict.position());
+
+  // letters only: same as strict
+  std::string unchecked(5U, '\0');
+  strict.transform<input::Unchecked>("nrnrs"sv, unchecked.data());
+  ASSERT_EQ("komxa"sv, unchecked);
+
+  // parallel_transform defaults to the policy of the machine as well
+  PassthroughM4     serial   = m4;
+  PassthroughM4     parallel = m4;
+  const std::string text     = make_mixed_input(parallel_min_chunk * 2U + 321U);
+  std::string       expected(text.size(), '\0');
+  std::string       parallel_output(text.size(), '\0');
+  serial.transform(text, expected.data());
+  ASSERT_EQ(parallel_output.data() + parallel_output.size(), parallel_transform(parallel, text, parallel_output.data(), 4U));
+  ASSERT_EQ(expected, parallel_output);
+  ASSERT_EQ(serial.snapshot(), parallel.snapshot());
+}
+
+TEST(EnigmaInputTests, dynamic_passthrough)
+{
+  DynamicEnigma              m4(Model::M4, ReflectorId::ThinB, {RotorId::GAMMA, RotorId::IV, RotorId::III, RotorId::VIII}, "AACU"sv, "LPWJ"sv, "BQ CH DI EJ GL KP NV OU SZ TY"sv);
+  constexpr std::string_view input = "NRNRS ECNDE KHLHJ"sv;
+  std::string                output(input.size(), '\0');
+  m4.transform<input::Passthrough>(input, output.data());
+  ASSERT_EQ("komxa dmxuu uboot"sv, output);
+  ASSERT_EQ(15U, m4.position());
+}
+
+template<class Input>
+static auto expect_parallel_matches_serial(const std::string &input) -> void
+{
+  M4          serial   = make_m4();
+  M4          parallel = make_m4();
+  std::string expected(input.size(), '\0');
+  std::string output(input.size(), '\0');
+  const auto  expected_size = static_cast<std::size_t>(serial.transform<Input>(input, expected.data()) - expected.data());
+  const auto  output_size   = static_cast<std::size_t>(parallel_transform<Input>(parallel, input, output.data(), 4U) - output.data());
+  ASSERT_EQ(expected_size, output_size);
+  ASSERT_EQ(expected, output);
+  ASSERT_EQ(serial.position(), parallel.position());
+  ASSERT_EQ(serial.snapshot(), parallel.snapshot());
+}
+
+TEST(EnigmaInputTests, parallel_policies)
+{
+  const std::string input = make_mixed_input(parallel_min_chunk * 4U + 1234U);
+  expect_parallel_matches_serial<input::Passthrough>(input);
+  expect_parallel_matches_serial<input::SkipNonLetters>(input);
+  expect_parallel_matches_serial<input::Placeholder>(input);
+  ASSERT_THROW(expect_parallel_matches_serial<input::Strict>(input), std::invalid_argument);
+}
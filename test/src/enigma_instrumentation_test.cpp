@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+#include "test_input.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+using test_input::make_input;
+
+namespace
+{
+  struct IdentityPlugboard
+  {
+    constexpr auto operator()(char letter) const -> char { return letter; }
+  };
+
+  using M3         = enmach::EnigmaM3<IdentityPlugboard, ukw::B, I, II, III>;
+  using CountingM3 = with_instrumentation_t<M3, instrumentation::Counting>;
+  using M4         = enmach::EnigmaM4<IdentityPlugboard, ukw::ThinB, GAMMA, VI, VII, VIII>;
+  using CountingM4 = with_instrumentation_t<M4, instrumentation::Counting>;
+
+  template<class Machine>
+  auto make_m4() -> Machine
+  {
+    Machine m4;
+    m4.setGrundstellung('l', 'p', 'w', 'j');
+    m4.setRingstellung('a', 'a', 'c', 'u');
+    return m4;
+  }
+
+  // Counters of the calls made since before
+  auto since(const instrumentation::Metrics &before) -> instrumentation::Metrics
+  {
+    const instrumentation::Metrics after = instrumentation::Counting::snapshot();
+    return {after.keypresses - before.keypresses,
+            after.middle_steps - before.middle_steps,
+            after.double_steps - before.double_steps,
+            after.left_steps - before.left_steps,
+            after.bulk_calls - before.bulk_calls,
+            after.bulk_characters - before.bulk_characters,
+            after.bulk_nanoseconds - before.bulk_nanoseconds,
+            after.parallel_calls - before.parallel_calls,
+            after.parallel_characters - before.parallel_characters,
+            after.parallel_nanoseconds - before.parallel_nanoseconds};
+  }
+} // namespace
+
+static_assert(!M3::Configuration::Instrumentation::enabled);
+static_assert(sizeof(CountingM3) == sizeof(M3));
+
+// ADU -> ADV -> AEW -> BFX, the double step of the middle rotor
+TEST(EnigmaInstrumentationTests, counts_double_step)
+{
+  CountingM3 m3;
+  m3.setGrundstellung('a', 'd', 'u');
+  const instrumentation::Metrics before = instrumentation::Counting::snapshot();
+  for (int press{}; press < 3; ++press)
+  {
+    m3.increment();
+    static_cast<void>(m3.exec('a'));
+  }
+  const instrumentation::Metrics metrics = since(before);
+  EXPECT_EQ(metrics.keypresses, 3U);
+  EXPECT_EQ(metrics.middle_steps, 2U);
+  EXPECT_EQ(metrics.double_steps, 1U);
+  EXPECT_EQ(metrics.left_steps, 1U);
+  EXPECT_EQ(metrics.bulk_calls, 0U);
+}
+
+TEST(EnigmaInstrumentationTests, transform_counts_like_increment)
+{
+  const std::string input = make_input(5000U);
+
+  CountingM4                     m4     = make_m4<CountingM4>();
+  const instrumentation::Metrics before = instrumentation::Counting::snapshot();
+  for (const char character : input)
+  {
+    m4.increment();
+    static_cast<void>(m4.exec(character));
+  }
+  const instrumentation::Metrics expected = since(before);
+  EXPECT_EQ(expected.keypresses, input.size());
+  EXPECT_GT(expected.double_steps, 0U);
+
+  for (const auto isa : {simd::Isa::Scalar, simd::Isa::SSSE3, simd::Isa::AVX2})
+    for (const bool sequence : {false, true})
+    {
+      std::string                    output(input.size(), '\0');
+      CountingM4                     machine = make_m4<CountingM4>();
+      const StepSequence             steps   = machine.stepSequence();
+      const instrumentation::Metrics start   = instrumentation::Counting::snapshot();
+      if (sequence)
+        machine.transform(input, output.data(), steps, isa);
+      else
+        machine.transform(input, output.data(), isa);
+      const instrumentation::Metrics metrics = since(start);
+      EXPECT_EQ(metrics.keypresses, expected.keypresses);
+      EXPECT_EQ(metrics.middle_steps, expected.middle_steps);
+      EXPECT_EQ(metrics.double_steps, expected.double_steps);
+      EXPECT_EQ(metrics.left_steps, expected.left_steps);
+      EXPECT_EQ(metrics.bulk_calls, 1U);
+      EXPECT_EQ(metrics.bulk_characters, input.size());
+      EXPECT_EQ(metrics.parallel_calls, 0U);
+    }
+}
+
+TEST(EnigmaInstrumentationTests, parallel_aggregates_threads)
+{
+  const std::string input = make_input(std::size_t{1} << 18U);
+  std::string       expected(input.size(), '\0');
+  std::string       output(input.size(), '\0');
+  M4                m4 = make_m4<M4>();
+  m4.transform(input, expected.data());
+
+  CountingM4                     counting = make_m4<CountingM4>();
+  const instrumentation::Metrics before   = instrumentation::Counting::snapshot();
+  parallel_transform(counting, input, output.data(), 4U);
+  const instrumentation::Metrics metrics = since(before);
+  EXPECT_EQ(output, expected);
+  EXPECT_EQ(metrics.parallel_calls, 1U);
+  EXPECT_EQ(metrics.parallel_characters, input.size());
+  EXPECT_EQ(metrics.bulk_calls, 4U);
+  EXPECT_EQ(metrics.bulk_characters, input.size());
+  EXPECT_EQ(metrics.keypresses, input.size());
+  EXPECT_EQ(counting.snapshot(), m4.snapshot());
+}
@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "enmach/Keyspace.hpp"
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+
+namespace
+{
+  const std::string plaintext = "allshipsintheharbourshouldremainatanchoruntilthestormhaspassedandthewindhasturnedtothewest";
+
+  auto encipher(Model model, const std::vector<RotorId> &rotors, std::string_view rings, std::string_view positions, std::size_t length) -> std::string
+  {
+    const CompiledKey key(model, model == Model::M4 ? ReflectorId::ThinB : ReflectorId::B, rotors, rings, positions, "AV BS CG");
+    Cursor            cursor = key.cursor();
+    std::string       result(length, '\0');
+    key.transform(cursor, std::string_view(plaintext).substr(0, length), result.data());
+    return result;
+  }
+
+  auto random_letters(std::mt19937 &random, std::size_t count) -> std::string
+  {
+    std::uniform_int_distribution<int> letters(0, 25);
+    std::string                        result;
+    for (std::size_t letter{}; letter < count; ++letter)
+      result += static_cast<char>('A' + letters(random));
+    return result;
+  }
+} // namespace
+
+TEST(EnigmaKeyspaceTests, canonical_settings_encipher_the_same)
+{
+  std::mt19937 random(7U);
+  const std::vector<std::vector<RotorId>> orders = {{RotorId::I, RotorId::II, RotorId::III}, {RotorId::IV, RotorId::VI, RotorId::VIII}, {RotorId::BETA, RotorId::II, RotorId::VII, RotorId::V}};
+  for (const auto &order : orders)
+  {
+    const Model model = order.size() == 4U ? Model::M4 : Model::M3;
+    for (const std::size_t length : {1U, 20U, 90U})
+    {
+      const Keyspace keyspace(model, order, length);
+      for (int trial{}; trial < 200; ++trial)
+      {
+        const std::string rings     = random_letters(random, order.size());
+        const std::string positions = random_letters(random, order.size());
+        const auto        setting   = keyspace.canonical(rings, positions);
+        EXPECT_EQ(encipher(model, order, setting.rings, setting.positions, length), encipher(model, order, rings, positions, length)) << rings << ' ' << positions << ' ' << length;
+        EXPECT_EQ(setting.rings[0], 'A');
+        const auto again = keyspace.canonical(setting.rings, setting.positions);
+        EXPECT_EQ(again.rings, setting.rings);
+        EXPECT_EQ(again.positions, setting.positions);
+      }
+    }
+  }
+  EXPECT_THROW(static_cast<void>(Keyspace(Model::M3, orders[0], 10U).canonical("AA", "AAA")), std::invalid_argument);
+  EXPECT_THROW(Keyspace(Model::M1, orders[1], 10U), std::invalid_argument);
+}
+
+TEST(EnigmaKeyspaceTests, size)
+{
+  // one key press looks at one offset of the middle and right rotor: notch there or not
+  const Keyspace single(Model::M3, {RotorId::I, RotorId::II, RotorId::III}, 1U);
+  EXPECT_EQ(single.total(), 308915776U);
+  EXPECT_EQ(single.size(), 4U * 26U * 26U * 26U);
+
+  // a whole revolution of both rotors, only the second notch of VI to VIII is redundant
+  const Keyspace whole(Model::M3, {RotorId::I, RotorId::VI, RotorId::VIII}, 26U * 26U * 2U);
+  EXPECT_EQ(whole.size(), 26U * 26U * 26U * 13U * 13U);
+  EXPECT_DOUBLE_EQ(whole.reduction(), 26.0 * 4.0);
+
+  // the Zusatzwalze ring is never looked at either
+  const Keyspace m4(Model::M4, {RotorId::GAMMA, RotorId::I, RotorId::II, RotorId::III}, 1U);
+  EXPECT_DOUBLE_EQ(m4.reduction(), single.reduction() * 26.0);
+}
+
+TEST(EnigmaKeyspaceTests, for_each)
+{
+  const std::vector<RotorId> order = {RotorId::III, RotorId::VII, RotorId::II};
+  const Keyspace             keyspace(Model::M3, order, 30U);
+  std::set<std::string>      trajectories;
+  std::uint64_t              count{};
+  keyspace.forEach([&](std::string_view rings, std::string_view positions) {
+    const auto setting = keyspace.canonical(rings, positions);
+    EXPECT_EQ(setting.rings, rings);
+    EXPECT_EQ(setting.positions, positions);
+    if (positions[0] == 'A')
+    {
+      const CompiledKey key(Model::M3, ReflectorId::B, order, rings, positions);
+      Odometer          odometer = unpack(key.cursor().state);
+      std::string       trajectory;
+      for (std::size_t press{}; press < 30U; ++press)
+      {
+        step(odometer, key.notches());
+        trajectory += {static_cast<char>('A' + odometer.left), static_cast<char>('A' + odometer.middle), static_cast<char>('A' + odometer.right)};
+      }
+      trajectories.insert(trajectory);
+    }
+    ++count;
+  });
+  EXPECT_EQ(count, keyspace.size());
+  // with the left rotor fixed, no two canonical settings step alike
+  EXPECT_EQ(trajectories.size() * 26U, count);
+}
+
+TEST(EnigmaKeyspaceTests, reduction)
+{
+  EXPECT_DOUBLE_EQ(Keyspace::reduction(Model::M4, 10U), Keyspace::reduction(Model::M3, 10U) * 26.0);
+  EXPECT_GT(Keyspace::reduction(Model::M1, 10U), Keyspace::reduction(Model::M1, 250U));
+  EXPECT_GT(Keyspace::reduction(Model::M3, 250U), 26.0);
+}
@@ -0,0 +1,70 @@
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+
+namespace
+{
+  template<class PlugboardValue>
+  struct Plugboard : public PlugboardValue
+  {
+    constexpr auto operator()(char letter) const -> char { return PlugboardValue::value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  constexpr Steckerbrett plugboard("ae bf cm dq hu jn lx pr sz vw"sv);
+  static_assert(plugboard[0] == 4U && plugboard[4] == 0U && plugboard[6] == 6U);
+  static_assert(Steckerbrett("AEBF"sv)[5] == Steckerbrett("fb ea"sv)[5]);
+} // namespace
+
+TEST(EnigmaPlugboardTests, matches_string_functor)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "efmqabguinkxcjordpzthwvlys"sv; };
+  // clang-format on
+  const Plugboard<PlugboardValue> functor{};
+  for (char letter = 'a'; letter <= 'z'; ++letter)
+    ASSERT_EQ(functor(letter), plugboard(letter));
+  ASSERT_EQ(make_plug_table(functor), plugboard.table());
+  ASSERT_EQ('e', plugboard('A'));
+  ASSERT_THROW((void)plugboard('.'), std::invalid_argument);
+}
+
+TEST(EnigmaPlugboardTests, m4_with_plugboard)
+{
+  enmach::EnigmaM4<Steckerbrett, ukw::ThinC, BETA, V, VI, VIII> m4(plugboard);
+  m4.setGrundstellung('i', 'g', 'z', 'q');
+  m4.setRingstellung('a', 'a', 'e', 'l');
+  constexpr std::string_view input    = "twnhyazgbilshewpglbpqlwqekitiafgzhwimcwdfxpafeilqzwfnrfttqhuoadvlrlgaoqkvlwlsjhwofjjsluveynrrajaqdkqbgmfycevkpfjpkowhhqzyzeqrtqikkxixtfpoemi"sv;
+  constexpr std::string_view expected = "fxdxuuuostyfuncquuufxwttxvvvuuueinseinsnuldreikkeiselekkxxistsechsstuendlichesdockenvormittagsamdreixfunfxinrendsburggemxfxdxuuuostmoeglichl"sv;
+  std::string                output;
+  for (const auto &character : input)
+  {
+    m4.increment();
+    output += m4.exec(character);
+  }
+  ASSERT_EQ(expected, output);
+
+  // the first key press turns a into b without cables, swapping a and b on both sides turns b into a
+  enmach::EnigmaM1<Steckerbrett, ukw::B, I, II, III> m1;
+  m1.setGrundstellung('a', 'a', 'a');
+  m1.increment();
+  ASSERT_EQ('b', m1.exec('a'));
+  m1.setPlugboard(Steckerbrett("ab"sv));
+  ASSERT_EQ('a', m1.exec('b'));
+}
+
+TEST(EnigmaPlugboardTests, invalid_pairs)
+{
+  ASSERT_THROW(Steckerbrett("ab ac"sv), std::invalid_argument);
+  ASSERT_THROW(Steckerbrett("aa"sv), std::invalid_argument);
+  ASSERT_THROW(Steckerbrett("abc"sv), std::invalid_argument);
+  ASSERT_THROW(Steckerbrett("a-b"sv), std::invalid_argument);
+  ASSERT_NO_THROW(Steckerbrett("ab cd ef gh ij kl mn op qr st uv wx yz"sv));
+}
@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+
+namespace
+{
+  template<class PlugboardValue>
+  struct Plugboard : public PlugboardValue
+  {
+    constexpr auto operator()(char letter) const -> char { return PlugboardValue::value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  template<class EM>
+  auto transform(EM em, const std::string_view &input, simd::Isa isa) -> std::string
+  {
+    std::string output(input.size(), '\0');
+    em.transform(input, output.data(), isa);
+    return output;
+  }
+
+  // Runs every kernel the CPU supports, unsupported ones fall back to the best available one
+  template<class EM>
+  auto expect_all_kernels(const EM &em, const std::string_view &input, const std::string_view &expected) -> void
+  {
+    for (const auto isa : {simd::Isa::Scalar, simd::Isa::SSSE3, simd::Isa::AVX2})
+      EXPECT_EQ(expected, transform(em, input, isa)) << "isa " << static_cast<int>(isa);
+  }
+
+  auto repeat(std::string_view pattern, std::size_t size) -> std::string
+  {
+    std::string result;
+    while (result.size() < size)
+      result.append(pattern.substr(0, size - result.size()));
+    return result;
+  }
+} // namespace
+
+TEST(EnigmaSimdTests, m1_even_longer_string)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "abcdefghijklmnopqrstuvwxyz"sv; };
+  // clang-format on
+  enmach::EnigmaM1<Plugboard<PlugboardValue>, ukw::B, I, II, III> m1;
+  m1.setGrundstellung('a', 'a', 'a');
+  m1.setRingstellung('a', 'a', 'a');
+  constexpr std::string_view expected = "bdzgowcxltksbtmcdlpbmuqofxyhcxtgyjflinhnxshiuntheorxpqpkovhcbubtzszsoostgotfsodbbzzlxlcyzxifgwfdzeeqibmgfjbwzfckpfmgbxqcivibbrncocjuvydkmvjpfmdrmtglwfozlxgjeyyqpvpbwnckvklztcbdldctsnrcoovptgbvbbisgjsoyhdenctnuukcughrevwbdjctqxxoglebzmdbrzosxdtzszbgdcfprbzyqgsncchgyewohvjbyzgkdgynneujiwctycytuumboyvunnqukksobscorsuoscnvroqlheudsukymigibsxpihntuvgghifqtgzxlgyqcnvnsrclvpyosvrbkcexrnlgdywebfxivkktugkpvmzotuogmhhzdrekjhlefkkpoxlwbwvbyukdtquhdqtrevrqjmqwndovwljhccxcfxrppxmsjezcjuftbrzzmcssnjnylcgloycitvyqxpdiyfgefyvxsxhkegxkmmdswbcyrkizocgmfddtmwztlssfljmooluuqjmijsciqvruistltgnclgkiktzhrxenrxjhyztlxicwwmywxdyiblerbflwjqywongiqqcuuqtpphbiehtuvgcegpeymwicgkwjcufkluidmjdivpjdmpgqpwitkgviboomtnduhqphgsqrjrnoovpwmdnxllvfiimkieyizmquwydpoultuwbukvmmwrlqlqsqpeugjrcxzwpfyiyybwloewrouvkpoztceuwtfjzqwpbqldttsrmdflgxbxzryqkdgjrzezmkhjnqypdjwcjfjlfntrsncnlgssg"sv;
+  const std::string          input(expected.size(), 'a');
+  expect_all_kernels(m1, input, expected);
+}
+
+TEST(EnigmaSimdTests, m3_all_together)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "zbcdrwghuylkmnopqestivfxja"sv; };
+  // clang-format on
+  enmach::EnigmaM3<Plugboard<PlugboardValue>, ukw::C, VI, III, VIII> m3;
+  m3.setGrundstellung('h', 'l', 'k');
+  m3.setRingstellung('h', 'l', 'k');
+  constexpr std::string_view input    = "nvkzhgdhmangsvksyiznoxqgknszoxbuiwoqueocihvvklgkgaemkxlpwlvg"sv;
+  constexpr std::string_view expected = "vinnjluztqxkpqlthluanqvljpankrdljtvhevnrkidyvschxisntajnacmo"sv;
+  expect_all_kernels(m3, input, expected);
+}
+
+TEST(EnigmaSimdTests, m4_P1030659)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "aqhijflcdepgmvukbrzyonwxts"sv; };
+  // clang-format on
+  enmach::EnigmaM4<Plugboard<PlugboardValue>, ukw::ThinB, GAMMA, IV, III, VIII> m4;
+  m4.setGrundstellung('y', 'v', 'o', 's');
+  m4.setRingstellung('a', 'a', 'c', 'u');
+  constexpr std::string_view input    = "YUPOVEJTBKONNFSALTWELQAZJXTIRJLLISCSGXSHEJFYNZQDNQSUXPGFTJKWINGORYBJYADWNFCLPPNSLWUYBUQISXGQ"sv;
+  constexpr std::string_view expected = "fffddduuuausbildungvonvonzwosechsuuuflottxxtttfffzwodreiausgezqestetmitssssssgcgxtttfffzwoqi"sv;
+  expect_all_kernels(m4, input, expected);
+}
+
+TEST(EnigmaSimdTests, m4_long_stream_matches_exec)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "efmqabguinkxcjordpzthwvlys"sv; };
+  // clang-format on
+  enmach::EnigmaM4<Plugboard<PlugboardValue>, ukw::ThinC, BETA, V, VI, VIII> m4;
+  m4.setGrundstellung('d', 'i', 't', 'l');
+  m4.setRingstellung('a', 'a', 'e', 'l');
+  const std::string input = repeat("osjfneiddkrblzacosgapemnrkpvgvkrvpztewhnaatfvhnhyrgszvekpnfazviatvjsliqwgrgcbfss"sv, 20000 + 17);
+  std::string       expected;
+  auto              reference = m4;
+  for (const auto &character : input)
+  {
+    reference.increment();
+    expected += reference.exec(character);
+  }
+  expect_all_kernels(m4, input, expected);
+}
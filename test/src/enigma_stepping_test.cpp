@@ -0,0 +1,174 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+
+namespace
+{
+  template<class PlugboardValue>
+  struct Plugboard : public PlugboardValue
+  {
+    constexpr auto operator()(char letter) const -> char { return PlugboardValue::value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  auto advance_matches_stepping(const Notches &notches, std::uint64_t count) -> bool
+  {
+    bool result{true};
+    for (std::uint8_t middle{}; middle < ETW.size(); ++middle)
+      for (std::uint8_t right{}; right < ETW.size(); ++right)
+      {
+        Odometer stepped{3U, middle, right};
+        Odometer advanced{3U, middle, right};
+        for (std::uint64_t i{}; i < count; ++i)
+          step(stepped, notches);
+        advance(advanced, notches, count);
+        result = result && stepped == advanced;
+      }
+    return result;
+  }
+} // namespace
+
+TEST(EnigmaSteppingTests, advance_single_notch)
+{
+  constexpr Notches notches{1U << 4U, 1U << 21U};
+  for (std::uint64_t count : {0U, 1U, 2U, 25U, 26U, 27U, 650U, 651U, 676U, 17000U})
+    ASSERT_TRUE(advance_matches_stepping(notches, count)) << count;
+}
+
+TEST(EnigmaSteppingTests, advance_double_notch)
+{
+  constexpr Notches notches{(1U << 25U) | (1U << 12U), (1U << 0U) | (1U << 13U)};
+  for (std::uint64_t count : {0U, 1U, 2U, 12U, 13U, 14U, 26U, 27U, 311U, 312U, 313U, 17000U})
+    ASSERT_TRUE(advance_matches_stepping(notches, count)) << count;
+}
+
+TEST(EnigmaSteppingTests, m3_advance_then_transform)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "zbcdrwghuylkmnopqestivfxja"sv; };
+  // clang-format on
+  enmach::EnigmaM3<Plugboard<PlugboardValue>, ukw::C, VI, III, VIII> m3;
+  m3.setGrundstellung('h', 'l', 'k');
+  m3.setRingstellung('h', 'l', 'k');
+  constexpr std::string_view input    = "vinnjluztqxkpqlthluanqvljpankrdljtvhevnrkidyvschxisntajnacmo"sv;
+  constexpr std::string_view expected = "nvkzhgdhmangsvksyiznoxqgknszoxbuiwoqueocihvvklgkgaemkxlpwlvg"sv;
+  std::string                output(input.size(), '\0');
+  m3.advance(40);
+  m3.transform(input.substr(40), output.data());
+  ASSERT_EQ(expected.substr(40), std::string_view(output.data(), input.size() - 40));
+  ASSERT_EQ(input.size(), m3.position());
+}
+
+TEST(EnigmaSteppingTests, m4_rewind)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "efmqabguinkxcjordpzthwvlys"sv; };
+  // clang-format on
+  enmach::EnigmaM4<Plugboard<PlugboardValue>, ukw::ThinC, BETA, V, VI, VIII> m4;
+  m4.setGrundstellung('i', 'g', 'z', 'q');
+  m4.setRingstellung('a', 'a', 'e', 'l');
+  constexpr std::string_view input    = "twnhyazgbilshewpglbpqlwqekitiafgzhwimcwdfxpafeilqzwfnrfttqhuoadvlrlgaoqkvlwlsjhwofjjsluveynrrajaqdkqbgmfycevkpfjpkowhhqzyzeqrtqikkxixtfpoemi"sv;
+  constexpr std::string_view expected = "fxdxuuuostyfuncquuufxwttxvvvuuueinseinsnuldreikkeiselekkxxistsechsstuendlichesdockenvormittagsamdreixfunfxinrendsburggemxfxdxuuuostmoeglichl"sv;
+  std::string                output(input.size(), '\0');
+  m4.advance(input.size());
+  m4.rewind(input.size() - 100);
+  m4.transform(input.substr(100), output.data());
+  ASSERT_EQ(expected.substr(100), std::string_view(output.data(), input.size() - 100));
+  m4.rewind(input.size());
+  m4.transform(input, output.data());
+  ASSERT_EQ(expected, output);
+  ASSERT_THROW(m4.rewind(input.size() + 1), std::out_of_range);
+}
+
+TEST(EnigmaSteppingTests, sequence_matches_stepping)
+{
+  constexpr Notches  notches{1U << 4U, 1U << 21U};
+  constexpr Odometer start{3U, 4U, 19U};
+  const StepSequence sequence(start, notches);
+  // the middle rotor skips one offset per revolution through the double step
+  ASSERT_EQ(ETW.size() * (ETW.size() - 1U) * ETW.size(), sequence.period());
+
+  Odometer    odometer = start;
+  std::size_t index{};
+  for (std::uint64_t count{1U}; count <= 2U * sequence.size(); ++count)
+  {
+    step(odometer, notches);
+    index = sequence.next(index);
+    ASSERT_EQ(sequence.index(count), index) << count;
+    ASSERT_EQ(odometer, (Odometer{sequence[index].left, sequence[index].middle, sequence[index].right})) << count;
+  }
+}
+
+TEST(EnigmaSteppingTests, m4_transform_with_sequence)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "efmqabguinkxcjordpzthwvlys"sv; };
+  // clang-format on
+  enmach::EnigmaM4<Plugboard<PlugboardValue>, ukw::ThinC, BETA, V, VI, VIII> m4;
+  m4.setGrundstellung('i', 'g', 'z', 'q');
+  m4.setRingstellung('a', 'a', 'e', 'l');
+  const StepSequence sequence = m4.stepSequence();
+
+  std::string input(40000U, '\0');
+  for (std::size_t i{}; i < input.size(); ++i)
+    input[i] = static_cast<char>('a' + (i * 11 + i / 17) % 26);
+  for (auto isa : {simd::Isa::Scalar, simd::Isa::SSSE3, simd::Isa::AVX2})
+  {
+    auto        reference = m4;
+    auto        sequenced = m4;
+    std::string expected(input.size(), '\0');
+    std::string output(input.size(), '\0');
+    // split in two so that the second call resumes from the middle of the sequence
+    reference.transform(input, expected.data(), isa);
+    sequenced.transform(input.substr(0U, 20001U), output.data(), sequence, isa);
+    sequenced.transform(input.substr(20001U), output.data() + 20001, sequence, isa);
+    ASSERT_EQ(expected, output);
+    ASSERT_EQ(reference.exec('a'), sequenced.exec('a'));
+  }
+
+  m4.setGrundstellung('a', 'a', 'a', 'a');
+  std::string output(1U, '\0');
+  ASSERT_THROW(m4.transform("a"sv, output.data(), sequence), std::invalid_argument);
+}
+
+TEST(EnigmaSteppingTests, m4_snapshot_restore)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "efmqabguinkxcjordpzthwvlys"sv; };
+  // clang-format on
+  enmach::EnigmaM4<Plugboard<PlugboardValue>, ukw::ThinC, BETA, V, VI, VIII> m4;
+  m4.setGrundstellung('i', 'g', 'z', 'q');
+  m4.setRingstellung('a', 'a', 'e', 'l');
+  const PackedState start = m4.snapshot();
+  // grundstellung - ringstellung for each rotor, Zusatzwalze first
+  ASSERT_EQ(0x08061505U, start.value);
+  ASSERT_EQ((Odometer{6U, 21U, 5U}), unpack(start));
+  ASSERT_EQ(8U, zusatzwalze(start));
+
+  constexpr std::string_view input = "twnhyazgbilshewpglbpqlwqekitiafgzhwimcwdfxpafeilqzwfnrfttqhuoadvlrlgaoqkvlwlsjhwofjjsluveynrrajaqdkqbgmfycevkpfjpkowhhqzyzeqrtqikkxixtfpoemi"sv;
+  std::string                first(input.size(), '\0');
+  std::string                second(input.size(), '\0');
+  m4.advance(1000U);
+  const PackedState checkpoint = m4.snapshot();
+  m4.transform(input, first.data());
+  ASSERT_NE(checkpoint, m4.snapshot());
+  ASSERT_NE(std::hash<PackedState>{}(checkpoint), std::hash<PackedState>{}(m4.snapshot()));
+
+  m4.restore(checkpoint);
+  ASSERT_EQ(0U, m4.position());
+  ASSERT_EQ(checkpoint, m4.snapshot());
+  m4.transform(input, second.data());
+  ASSERT_EQ(first, second);
+
+  ASSERT_THROW(m4.restore(PackedState{26U}), std::invalid_argument);
+  enmach::EnigmaM3<Plugboard<PlugboardValue>, ukw::C, VI, III, VIII> m3;
+  ASSERT_THROW(m3.restore(PackedState{1U << 24U}), std::invalid_argument);
+}
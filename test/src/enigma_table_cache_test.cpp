@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "enmach/TableCache.hpp"
+#include "enmach/enmach.hpp"
+#include "test_input.hpp"
+
+using namespace enmach;
+using test_input::make_input;
+
+namespace
+{
+  auto encrypt(std::shared_ptr<const CompiledKey> key, const std::string &input) -> std::string
+  {
+    DynamicEnigma machine(std::move(key));
+    std::string   output(input.size(), '\0');
+    machine.transform(input, output.data(), simd::Isa::Scalar);
+    return output;
+  }
+
+  auto expect_matches_uncached(const std::shared_ptr<const TableCache> &tables, Model model, ReflectorId reflector, const std::vector<RotorId> &rotors, const std::string &rings, const std::string &positions) -> void
+  {
+    const std::string input = make_input(20000);
+    const auto        plain = std::make_shared<const CompiledKey>(model, reflector, rotors, rings, positions, "AV BS CG");
+    const auto        fast  = std::make_shared<const CompiledKey>(tables->compile(model, reflector, rotors, rings, positions, "AV BS CG"));
+    EXPECT_EQ(encrypt(fast, input), encrypt(plain, input));
+  }
+
+  auto corrupt(const std::string &from, const std::string &to, std::size_t offset) -> void
+  {
+    std::ifstream source(from, std::ios::binary);
+    std::string   content((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+    if (offset < content.size())
+      content[offset] = static_cast<char>(content[offset] ^ 1);
+    else
+      content.resize(content.size() - 8U);
+    std::ofstream(to, std::ios::binary | std::ios::trunc) << content;
+  }
+} // namespace
+
+TEST(EnigmaTableCacheTests, matches_uncached_keys)
+{
+  const std::string path = testing::TempDir() + "enmach_tables_m3.bin";
+  std::remove(path.c_str());
+  const auto tables = TableCache::openOrGenerate(path, Model::M3);
+  EXPECT_EQ(tables->model(), Model::M3);
+  EXPECT_EQ(tables->size(), 64U + 3U * 56U * 26U * 26U * 26U);
+  EXPECT_TRUE(tables->verify());
+
+  expect_matches_uncached(tables, Model::M3, ReflectorId::B, {RotorId::II, RotorId::IV, RotorId::V}, "bul", "wza");
+  expect_matches_uncached(tables, Model::M3, ReflectorId::C, {RotorId::VIII, RotorId::VI, RotorId::VII}, "hlk", "qev");
+  expect_matches_uncached(tables, Model::M1, ReflectorId::A, {RotorId::III, RotorId::I, RotorId::V}, "aaa", "zzz");
+  // not in an M3 file, computed as usual
+  expect_matches_uncached(tables, Model::M4, ReflectorId::ThinB, {RotorId::BETA, RotorId::II, RotorId::IV, RotorId::I}, "aaav", "vjna");
+
+  // a second process maps the same file
+  EXPECT_EQ(TableCache::openOrGenerate(path, Model::M3)->size(), tables->size());
+  EXPECT_THROW(static_cast<void>(TableCache::openOrGenerate(path, Model::M1)), std::invalid_argument);
+  std::remove(path.c_str());
+}
+
+TEST(EnigmaTableCacheTests, key_outlives_cache_handle)
+{
+  const std::string path = testing::TempDir() + "enmach_tables_m1.bin";
+  TableCache::generate(path, Model::M1);
+  auto       tables = TableCache::open(path);
+  const auto key    = std::make_shared<const CompiledKey>(tables->compile(Model::M1, ReflectorId::B, {RotorId::I, RotorId::II, RotorId::III}, "aaa", "aaa"));
+  tables.reset();
+  std::remove(path.c_str());
+
+  const auto plain = std::make_shared<const CompiledKey>(Model::M1, ReflectorId::B, std::vector<RotorId>{RotorId::I, RotorId::II, RotorId::III}, "aaa", "aaa");
+  EXPECT_EQ(encrypt(key, make_input(5000)), encrypt(plain, make_input(5000)));
+}
+
+TEST(EnigmaTableCacheTests, rejects_damaged_files)
+{
+  const std::string path    = testing::TempDir() + "enmach_tables_damaged_source.bin";
+  const std::string damaged = testing::TempDir() + "enmach_tables_damaged.bin";
+  TableCache::generate(path, Model::M1);
+
+  // magic, version, wiring fingerprint, truncation
+  for (const std::size_t offset : {std::size_t{0}, std::size_t{8}, std::size_t{16}, ~std::size_t{}})
+  {
+    corrupt(path, damaged, offset);
+    EXPECT_THROW(static_cast<void>(TableCache::open(damaged)), std::invalid_argument) << offset;
+  }
+  // a damaged payload is only found by reading it
+  corrupt(path, damaged, 4096U);
+  EXPECT_FALSE(TableCache::open(damaged)->verify());
+  EXPECT_THROW(static_cast<void>(TableCache::openOrGenerate(damaged, Model::M1)), std::invalid_argument);
+  EXPECT_TRUE(TableCache::open(path)->verify());
+  EXPECT_THROW(static_cast<void>(TableCache::open(testing::TempDir() + "enmach_tables_missing.bin")), std::system_error);
+  std::remove(path.c_str());
+  std::remove(damaged.c_str());
+}
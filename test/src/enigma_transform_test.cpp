@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "enmach/enmach.hpp"
+
+using namespace enmach;
+using namespace enmach::rotor_tags;
+using namespace std::literals;
+
+namespace
+{
+  template<class PlugboardValue>
+  struct Plugboard : public PlugboardValue
+  {
+    constexpr auto operator()(char letter) const -> char { return PlugboardValue::value.at(static_cast<std::size_t>(letter - 'a')); }
+  };
+
+  template<class EM>
+  auto decrypt(EM &em, const std::string_view &input) -> std::string
+  {
+    std::string output;
+    output.reserve(input.size());
+    for (const auto &character : input)
+    {
+      em.increment();
+      output += em.exec(character);
+    }
+    return output;
+  }
+} // namespace
+
+TEST(EnigmaTransformTests, m1_matches_expected)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "abcdefghijklmnopqrstuvwxyz"sv; };
+  // clang-format on
+  enmach::EnigmaM1<Plugboard<PlugboardValue>, ukw::B, I, II, III> m1;
+  m1.setGrundstellung('a', 'a', 'a');
+  m1.setRingstellung('a', 'a', 'a');
+  constexpr std::string_view input    = "AAAAA"sv;
+  constexpr std::string_view expected = "bdzgo"sv;
+  std::string                output(input.size(), '\0');
+  char                      *end = m1.transform(input, output.data());
+  ASSERT_EQ(output.data() + output.size(), end);
+  ASSERT_EQ(expected, output);
+}
+
+TEST(EnigmaTransformTests, m3_matches_per_character_exec)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "zbcdrwghuylkmnopqestivfxja"sv; };
+  // clang-format on
+  enmach::EnigmaM3<Plugboard<PlugboardValue>, ukw::C, VI, III, VIII> reference;
+  reference.setGrundstellung('h', 'l', 'k');
+  reference.setRingstellung('h', 'l', 'k');
+  auto bulk = reference;
+
+  constexpr std::string_view input    = "nvkzhgdhmangsvksyiznoxqgknszoxbuiwoqueocihvvklgkgaemkxlpwlvg"sv;
+  const std::string          expected = decrypt(reference, input);
+  std::string                output(input.size(), '\0');
+  bulk.transform(input, output.data());
+  ASSERT_EQ(expected, output);
+  // both machines must have stepped identically
+  ASSERT_EQ(reference.exec('a'), bulk.exec('a'));
+}
+
+TEST(EnigmaTransformTests, m4_in_place)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "efmqabguinkxcjordpzthwvlys"sv; };
+  // clang-format on
+  enmach::EnigmaM4<Plugboard<PlugboardValue>, ukw::ThinC, BETA, V, VI, VIII> m4;
+  m4.setGrundstellung('i', 'g', 'z', 'q');
+  m4.setRingstellung('a', 'a', 'e', 'l');
+  constexpr std::string_view expected = "fxdxuuuostyfuncquuufxwttxvvvuuueinseinsnuldreikkeiselekkxxistsechsstuendlichesdockenvormittagsamdreixfunfxinrendsburggemxfxdxuuuostmoeglichl"sv;
+  std::string                buffer   = "twnhyazgbilshewpglbpqlwqekitiafgzhwimcwdfxpafeilqzwfnrfttqhuoadvlrlgaoqkvlwlsjhwofjjsluveynrrajaqdkqbgmfycevkpfjpkowhhqzyzeqrtqikkxixtfpoemi";
+  m4.transform(buffer.data(), buffer.data() + buffer.size(), buffer.data());
+  ASSERT_EQ(expected, buffer);
+}
+
+TEST(EnigmaTransformTests, invalid_input_does_not_step)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "abcdefghijklmnopqrstuvwxyz"sv; };
+  // clang-format on
+  enmach::EnigmaM1<Plugboard<PlugboardValue>, ukw::B, I, II, III> m1;
+  m1.setGrundstellung('a', 'a', 'a');
+  m1.setRingstellung('a', 'a', 'a');
+  std::string output(8, '\0');
+  ASSERT_THROW(m1.transform("aaaa.aaa"sv, output.data()), std::invalid_argument);
+  m1.transform("aaaaa"sv, output.data());
+  ASSERT_EQ("bdzgo"sv, std::string_view(output.data(), 5));
+}
+
+TEST(EnigmaTransformTests, parallel_matches_serial)
+{
+  // clang-format off
+  struct PlugboardValue{ std::string_view value = "zbcdrwghuylkmnopqestivfxja"sv; };
+  // clang-format on
+  enmach::EnigmaM3<Plugboard<PlugboardValue>, ukw::C, VI, III, VIII> serial;
+  serial.setGrundstellung('h', 'l', 'k');
+  serial.setRingstellung('h', 'l', 'k');
+  auto parallel = serial;
+
+  std::string input(parallel_min_chunk * 5 + 123, '\0');
+  for (std::size_t i{}; i < input.size(); ++i)
+    input[i] = static_cast<char>('a' + (i * 7 + i / 31) % 26);
+  std::string expected(input.size(), '\0');
+  std::string output(input.size(), '\0');
+  serial.transform(input, expected.data());
+  char *end = parallel_transform(parallel, input, output.data(), 4);
+  ASSERT_EQ(output.data() + output.size(), end);
+  ASSERT_EQ(expected, output);
+  ASSERT_EQ(serial.position(), parallel.position());
+  ASSERT_EQ(serial.exec('a'), parallel.exec('a'));
+}
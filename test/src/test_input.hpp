@@ -0,0 +1,20 @@
+#ifndef ENMACH_TEST_INPUT_HPP_
+#define ENMACH_TEST_INPUT_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace test_input
+{
+  // size letters running through the alphabet in steps of 7 and shifting every 31 letters, so that no short period
+  // repeats. seed shifts the pattern, mixed_case makes every third letter uppercase.
+  inline auto make_input(std::size_t size, std::size_t seed = 0U, bool mixed_case = false) -> std::string
+  {
+    std::string input(size, '\0');
+    for (std::size_t i{}; i < size; ++i)
+      input[i] = static_cast<char>((mixed_case && (i + seed) % 3U == 0U ? 'A' : 'a') + (i * 7U + seed + i / 31U) % 26U);
+    return input;
+  }
+} // namespace test_input
+
+#endif // ENMACH_TEST_INPUT_HPP_